@@ -0,0 +1,137 @@
+#include "Benchmark.hpp"
+#include "Intersection.hpp"
+#include "ProfileCodec.hpp"
+#include "ThreadPool.hpp"
+
+#include <sys/resource.h>
+
+using namespace std;
+
+Benchmark::StageTimer::StageTimer(Benchmark &b, const char *stageName)
+    : benchmark(b), name(stageName), start(Clock::now())
+{
+}
+
+Benchmark::StageTimer::~StageTimer()
+{
+    benchmark.addStage(name, chrono::duration<double>(Clock::now() - start).count());
+}
+
+Benchmark::Benchmark() : created(Clock::now())
+{
+}
+
+void Benchmark::addStage(const string &name, double seconds)
+{
+    stages.emplace_back(name, seconds);
+}
+
+void Benchmark::setUserLatencies(vector<float> seconds)
+{
+    userLatencies = move(seconds);
+}
+
+void Benchmark::setThreadTimings(vector<ThreadTiming> threadTimings)
+{
+    timings = move(threadTimings);
+}
+
+void Benchmark::setCacheStats(const SimilarityCacheStats &stats)
+{
+    cacheStats = stats;
+}
+
+// Percentil pelo método nearest-rank.
+double Benchmark::percentile(const vector<float> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+    const size_t rank = static_cast<size_t>(ceil(p / 100.0 * sorted.size()));
+    return sorted[min(sorted.size(), max<size_t>(1, rank)) - 1];
+}
+
+bool Benchmark::writeJson(const string &filename) const
+{
+    const double totalSeconds = chrono::duration<double>(Clock::now() - created).count();
+
+    vector<float> sorted(userLatencies);
+    sort(sorted.begin(), sorted.end());
+
+    // Histograma em potências de 2 de microssegundos: bucket i cobre [2^i, 2^(i+1)) us.
+    vector<size_t> histogram;
+    for (float seconds : sorted)
+    {
+        const uint64_t micros = static_cast<uint64_t>(seconds * 1e6);
+        const size_t bucket = micros == 0 ? 0 : 63 - __builtin_clzll(micros);
+        if (histogram.size() <= bucket)
+            histogram.resize(bucket + 1, 0);
+        histogram[bucket]++;
+    }
+
+    double recommendSeconds = 0.0;
+    for (const auto &[name, seconds] : stages)
+    {
+        if (name == "recommend")
+            recommendSeconds += seconds;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    const filesystem::path path(filename);
+    if (path.has_parent_path())
+        filesystem::create_directories(path.parent_path());
+
+    ofstream out(filename);
+    if (!out.is_open())
+        return false;
+
+    out << fixed << setprecision(6);
+    out << "{\n";
+    out << "  \"threads\": " << ThreadPool::instance().concurrency() << ",\n";
+    out << "  \"hardware_concurrency\": " << thread::hardware_concurrency() << ",\n";
+    out << "  \"intersection_kernel\": \"" << Intersection::kernelName() << "\",\n";
+    out << "  \"profile_decode_kernel\": \"" << ProfileCodec::kernelName() << "\",\n";
+    out << "  \"total_seconds\": " << totalSeconds << ",\n";
+    out << "  \"peak_rss_kb\": " << usage.ru_maxrss << ",\n";
+
+    out << "  \"stages\": {";
+    for (size_t i = 0; i < stages.size(); ++i)
+    {
+        out << (i ? ",\n" : "\n") << "    \"" << stages[i].first << "\": " << stages[i].second;
+    }
+    out << "\n  },\n";
+
+    out << "  \"users\": " << sorted.size() << ",\n";
+    out << "  \"throughput_users_per_second\": " << (recommendSeconds > 0 ? sorted.size() / recommendSeconds : 0.0) << ",\n";
+    out << "  \"latency_seconds\": {\n";
+    out << "    \"p50\": " << percentile(sorted, 50) << ",\n";
+    out << "    \"p95\": " << percentile(sorted, 95) << ",\n";
+    out << "    \"p99\": " << percentile(sorted, 99) << ",\n";
+    out << "    \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << ",\n";
+    out << "    \"histogram_log2_us\": [";
+    for (size_t i = 0; i < histogram.size(); ++i)
+    {
+        out << (i ? ", " : "") << histogram[i];
+    }
+    out << "]\n  },\n";
+
+    out << "  \"thread_timings\": [";
+    for (size_t t = 0; t < timings.size(); ++t)
+    {
+        out << (t ? ",\n" : "\n") << "    {\"users\": " << timings[t].users
+            << ", \"busy_seconds\": " << timings[t].busySeconds
+            << ", \"idle_seconds\": " << timings[t].idleSeconds << "}";
+    }
+    out << "\n  ],\n";
+
+    out << "  \"similarity_cache\": {\"hits\": " << cacheStats.hits
+        << ", \"misses\": " << cacheStats.misses
+        << ", \"insertions\": " << cacheStats.insertions
+        << ", \"evictions\": " << cacheStats.evictions
+        << ", \"capacity\": " << cacheStats.capacity
+        << ", \"bytes\": " << cacheStats.bytes << "}\n";
+    out << "}\n";
+
+    return static_cast<bool>(out);
+}
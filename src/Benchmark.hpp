@@ -0,0 +1,59 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include "Config.hpp"
+#include "SimilarityCache.hpp"
+
+// Tempo de cada participante do pool durante o último processRecommendations.
+struct ThreadTiming
+{
+    double busySeconds = 0.0;
+    double idleSeconds = 0.0;
+    size_t users = 0;
+};
+
+// Coleta os tempos de cada estágio, a latência por usuário, os contadores do cache de
+// similaridades e o pico de memória de uma execução, e grava tudo em JSON (modo --bench / make bench).
+class Benchmark
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Mede o escopo em que foi criado e registra o resultado como um estágio.
+    class StageTimer
+    {
+    public:
+        StageTimer(Benchmark &benchmark, const char *name);
+        ~StageTimer();
+
+        StageTimer(const StageTimer &) = delete;
+        StageTimer &operator=(const StageTimer &) = delete;
+
+    private:
+        Benchmark &benchmark;
+        const char *name;
+        Clock::time_point start;
+    };
+
+    Benchmark();
+
+    void addStage(const std::string &name, double seconds);
+    void setUserLatencies(std::vector<float> seconds);
+    void setThreadTimings(std::vector<ThreadTiming> timings);
+    void setCacheStats(const SimilarityCacheStats &stats);
+
+    const std::vector<ThreadTiming> &threadTimings() const { return timings; }
+
+    bool writeJson(const std::string &filename) const;
+
+private:
+    Clock::time_point created;
+    std::vector<std::pair<std::string, double>> stages;
+    std::vector<float> userLatencies;
+    std::vector<ThreadTiming> timings;
+    SimilarityCacheStats cacheStats;
+
+    static double percentile(const std::vector<float> &sorted, double p);
+};
+
+#endif
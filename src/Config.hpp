@@ -2,6 +2,7 @@
 #define CONFIG_HPP
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <charconv>
 #include <chrono>
@@ -17,6 +18,7 @@
 #include <memory>
 #include <mutex>
 #include <random>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -45,16 +47,58 @@ namespace Config
    const float MIN_SIMILARITY = 0.01f; // Limiar mínimo de similaridade para que um usuário seja considerado no cálculo.
    const int MAX_CANDIDATES = 1000;    // Número máximo de filmes candidatos a serem considerados antes do ranqueamento final.
 
+   enum class SimilarityMetric
+   {
+      Cosine,         // Cosseno sobre as notas cruas.
+      AdjustedCosine, // Cosseno sobre as notas menos a média de cada usuário (Pearson centrado no usuário).
+   };
+   const SimilarityMetric SIMILARITY_METRIC = SimilarityMetric::Cosine; // Métrica de similaridade entre usuários (--adjusted-cosine).
+
    // --- Parâmetros para o Locality-Sensitive Hashing (LSH) ---
    const int NUM_HASH_FUNCTIONS = 96;        // Número total de funções de hash a serem utilizadas no MinHashing.
    const int NUM_BANDS = 24;                 // Número de bandas para o LSH. Aumentar este valor aumenta a chance de encontrar candidatos similares.
    const int ROWS_PER_BAND = 4;              // Número de linhas (hashes) por banda. Calculado como `NUM_HASH_FUNCTIONS / NUM_BANDS`.
    const int NUM_TABLES = 8;                 // Número de tabelas de hash. Um balanço entre performance e a qualidade (recall) dos resultados.
+   const int LSH_BANDS_PER_TABLE = 3;        // Bandas consecutivas combinadas na chave de cada tabela.
+   const size_t LSH_NUM_BUCKETS = 4000;      // Número de buckets por tabela.
+   const int LSH_SIGNATURE_BITS = 0;         // 1, 2 ou 4: estima o Jaccard dos candidatos por assinaturas b-bit empacotadas (0 usa os hashes inteiros).
+   const uint32_t LSH_SEED = 0;              // Semente das funções de hash (--seed=N); 0 sorteia uma nova a cada execução.
    const uint32_t LARGE_PRIME = 4294967291u; // Um número primo grande usado nos cálculos das funções de hash.
 
+   // --- Tag Genome ---
+   const bool USE_GENOME = false;       // Se verdadeiro, carrega o genome-scores.csv e soma a afinidade de tags aos candidatos (--genome).
+   const float GENOME_WEIGHT = 1.0f;    // Peso da afinidade (cosseno entre o gosto do usuário e o vetor de tags do filme).
+   const int GENOME_MAX_TAGS = 2048;    // Maior tagId aceito; linhas acima disso são ignoradas.
+
+   // --- Avaliação Offline e Ajuste do LSH ---
+   const float EVAL_HOLDOUT = 0.2f;         // Fração das notas de cada usuário avaliado retirada do modelo (--evaluate, --tune).
+   const size_t EVAL_MIN_PROFILE = 5;       // Usuários com menos notas que isso ficam fora da avaliação.
+   const int EVAL_NEIGHBORS = 50;           // Vizinhos exatos (top-N por similaridade) usados no recall do LSH.
+   const float TUNE_RECALL_TARGET = 0.8f;   // Recall mínimo dos vizinhos para a configuração recomendada pelo --tune.
+
+   // --- Filtragem Colaborativa por Item ---
+   const bool ITEM_BASED = false;         // Se verdadeiro, pontua pelos vizinhos item-item pré-calculados em vez dos usuários do LSH (--item-based).
+   const int ITEM_NEIGHBORS = 50;         // Número de vizinhos mais similares guardados por filme.
+   const int ITEM_MIN_CORATERS = 3;       // Número mínimo de usuários em comum para que dois filmes sejam vizinhos.
+   const size_t ITEM_MAX_PROFILE = 1000;  // Perfis maiores ficam fora da co-ocorrência item-item (custo quadrático e pouco sinal).
+   const float ITEM_SHRINKAGE = 1.0f;     // Somado à soma das similaridades no score, para vizinhanças com pouca evidência não dominarem.
+   const bool EXACT_NEIGHBORS = false;    // Se verdadeiro, calcula o kNN exato dos usuários a recomendar numa passada só, em vez do LSH (--exact-neighbors).
+
    // --- Parâmetros de Desempenho e Concorrência ---
-   const int NUM_THREADS = std::thread::hardware_concurrency() - 2; // Número de threads para processamento paralelo. Deixa 2 núcleos livres para o sistema.
+   const int NUM_THREADS = std::max(1u, std::thread::hardware_concurrency()); // Número de threads do pool de trabalho compartilhado (incluindo a thread que aguarda as tarefas).
    const int BATCH_SIZE = 100;                                      // Tamanho do lote de usuários a ser processado por cada thread.
+   const size_t SCHEDULE_CHUNK_SIZE = 4;                            // Usuários retirados por vez do cursor compartilhado (ordenados do mais caro para o mais barato).
+   const bool BATCH_RECOMMEND = false;                              // Se verdadeiro, recomenda em grupos de usuários com buckets LSH em comum, compartilhando os perfis dos candidatos (--batch).
+   const size_t RECOMMEND_GROUP_SIZE = 8;                           // Usuários por grupo no modo em lote.
+   const size_t SIMILARITY_CACHE_MB = 64;                           // Limite de memória do cache de similaridades; acima dele as entradas são substituídas (CLOCK).
+   const size_t SIMILARITY_CACHE_SHARDS = 64;                       // Número de shards do cache de similaridades (cada shard tem seu próprio lock de escrita).
+
+   // --- Formato da Saída ---
+   const bool ORDERED_OUTPUT = false; // Se verdadeiro, as recomendações são gravadas na ordem do arquivo de usuários (--ordered-output).
+   const bool BINARY_OUTPUT = false;  // Se verdadeiro, grava registros binários (userId, quantidade, movieIds em uint32) (--binary-output).
+
+   // --- Pré-processamento ---
+   const bool WRITE_INPUT_FILE = false; // Se verdadeiro, o pré-processamento também grava o input.dat (--write-input); senão os dados vão direto para a memória.
 
    // --- Pesos para o Sistema Híbrido ---
    const float CF_WEIGHT = 1.0f;         // Peso para o score do Filtro Colaborativo (Collaborative Filtering).
@@ -70,8 +114,15 @@ namespace Config
    // --- Caminhos dos Arquivos ---
    inline static const std::string USERS_FILE = "datasets/explore.dat"; // Arquivo com os usuários para os quais as recomendações serão geradas.
    inline static const std::string MOVIES_FILE = "ml-25m/movies.csv";   // Arquivo com os metadados dos filmes.
+   inline static const std::string GENOME_FILE = "ml-25m/genome-scores.csv"; // Relevância de cada tag para cada filme (Tag Genome do MovieLens).
    inline static const std::string RATINGS_FILE = "datasets/input.dat"; // Arquivo com o histórico de avaliações dos usuários.
    inline static const std::string OUTPUT_FILE = "outcome/output.dat";  // Arquivo de saída para salvar as recomendações geradas.
+   inline static const std::string BINARY_OUTPUT_FILE = "outcome/output.bin"; // Arquivo de saída usado no formato binário.
+   inline static const std::string BENCH_FILE = "outcome/bench.json";          // Relatório JSON do modo benchmark (--bench).
+   inline static const std::string EVALUATION_FILE = "outcome/evaluation.json"; // Relatório JSON da avaliação offline (--evaluate) ou do ajuste do LSH (--tune).
+   inline static const std::string SNAPSHOT_FILE = "datasets/model.bin"; // Snapshot binário do modelo de avaliações, carregado via mmap quando atualizado em relação ao ratings.csv.
+   inline static const std::string ITEM_NEIGHBORS_FILE = "datasets/item_neighbors.bin"; // Tabela de vizinhos item-item persistida, reconstruída quando o ratings.csv muda.
+   inline static const std::string USER_NEIGHBORS_FILE = "datasets/user_neighbors.bin"; // kNN exato dos usuários de USERS_FILE, reconstruído quando o ratings.csv ou a lista de usuários muda.
 }
 
 #endif 
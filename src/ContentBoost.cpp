@@ -0,0 +1,51 @@
+#include "ContentBoost.hpp"
+
+using namespace std;
+
+void ContentBoostIndex::build(const RatingStore &store)
+{
+    const size_t numMovies = store.numMovies();
+    movieGenres = store.movieGenres;
+    movieBoost.assign(numMovies, 0.0f);
+
+    unordered_map<uint32_t, uint32_t> groupOf;
+    vector<uint32_t> groupSizes;
+    groupGenres.clear();
+    for (uint32_t movieIdx = 0; movieIdx < numMovies; ++movieIdx)
+    {
+        float quality = store.movieAvgRating[movieIdx] / 5.0f;
+        float popularity = min(1.0f, static_cast<float>(log(store.moviePopularity[movieIdx] + 1) / 10.0));
+
+        movieBoost[movieIdx] = (0.3f * quality + 0.7f * popularity) * Config::CB_WEIGHT +
+                               popularity * Config::POPULARITY_WEIGHT;
+
+        if (movieGenres[movieIdx] == 0)
+            continue;
+        const auto inserted = groupOf.emplace(movieGenres[movieIdx], static_cast<uint32_t>(groupGenres.size()));
+        if (inserted.second)
+        {
+            groupGenres.push_back(movieGenres[movieIdx]);
+            groupSizes.push_back(0);
+        }
+        ++groupSizes[inserted.first->second];
+    }
+
+    groupOffsets.assign(groupGenres.size() + 1, 0);
+    for (size_t g = 0; g < groupGenres.size(); ++g)
+    {
+        groupOffsets[g + 1] = groupOffsets[g] + groupSizes[g];
+    }
+
+    groupEntries.resize(groupOffsets.back());
+    vector<uint32_t> fill(groupOffsets.begin(), groupOffsets.end() - 1);
+    for (uint32_t movieIdx = 0; movieIdx < numMovies; ++movieIdx)
+    {
+        if (movieGenres[movieIdx] != 0)
+            groupEntries[fill[groupOf[movieGenres[movieIdx]]]++] = {movieIdx, movieBoost[movieIdx]};
+    }
+
+    for (size_t g = 0; g < groupGenres.size(); ++g)
+    {
+        sort(groupEntries.begin() + groupOffsets[g], groupEntries.begin() + groupOffsets[g + 1], ranksBefore);
+    }
+}
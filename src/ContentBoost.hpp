@@ -0,0 +1,130 @@
+#ifndef CONTENT_BOOST_HPP
+#define CONTENT_BOOST_HPP
+
+#include "Config.hpp"
+#include "RatingStore.hpp"
+
+// Boost de conteúdo pré-calculado. O valor de cada filme não depende do usuário: o filme recebe
+// movieBoost uma vez para cada gênero preferido que tiver. Os filmes ficam agrupados pelo conjunto
+// exato de gêneros e ranqueados dentro do grupo; para uma máscara o multiplicador do grupo é fixo,
+// então basta intercalar o começo dos grupos que tocam a máscara.
+class ContentBoostIndex
+{
+public:
+    struct Entry
+    {
+        uint32_t movie;
+        float boost;
+    };
+
+    // Ordem das listas: boost decrescente, empate pelo menor índice.
+    static bool ranksBefore(const Entry &a, const Entry &b)
+    {
+        return a.boost != b.boost ? a.boost > b.boost : a.movie < b.movie;
+    }
+
+    // Depende das médias, da popularidade e dos gêneros dos filmes (depois de loadMovies).
+    void build(const RatingStore &store);
+
+    bool empty() const { return movieBoost.empty(); }
+
+    // score somado ao boost do filme uma vez por gênero de mask, na mesma ordem do cálculo original.
+    float addBoost(float score, uint32_t movieIdx, uint32_t mask) const
+    {
+        const float boost = movieBoost[movieIdx];
+        for (uint32_t genres = movieGenres[movieIdx] & mask; genres; genres &= genres - 1)
+        {
+            score += boost;
+        }
+        return score;
+    }
+
+    // Chama visit com os limit filmes de maior boost total para mask entre os aceitos por eligible.
+    // O topo de cada grupo limita o resto dele, então a intercalação para assim que nenhum topo
+    // alcança o pior dos limit escolhidos.
+    template <typename Eligible, typename Visit>
+    void forEachTop(uint32_t mask, size_t limit, Eligible eligible, Visit visit) const
+    {
+        struct Cursor
+        {
+            Entry head;
+            const Entry *next;
+            const Entry *end;
+            int common;
+        };
+        auto behind = [](const Cursor &a, const Cursor &b)
+        { return ranksBefore(b.head, a.head); };
+        // Mesma soma de addBoost, com o número de gêneros em comum fixo do grupo.
+        auto advance = [](Cursor &cursor)
+        {
+            cursor.head = {cursor.next->movie, 0.0f};
+            for (int i = 0; i < cursor.common; ++i)
+            {
+                cursor.head.boost += cursor.next->boost;
+            }
+        };
+
+        std::vector<Cursor> cursors;
+        cursors.reserve(groupGenres.size());
+        for (size_t g = 0; g < groupGenres.size(); ++g)
+        {
+            if (groupGenres[g] & mask)
+            {
+                cursors.push_back({{}, groupEntries.data() + groupOffsets[g], groupEntries.data() + groupOffsets[g + 1],
+                                   __builtin_popcount(groupGenres[g] & mask)});
+                advance(cursors.back());
+            }
+        }
+        std::make_heap(cursors.begin(), cursors.end(), behind);
+
+        std::vector<Entry> best;
+        best.reserve(limit);
+        while (!cursors.empty() && limit > 0)
+        {
+            if (best.size() == limit && cursors.front().head.boost < best.front().boost)
+                break;
+
+            std::pop_heap(cursors.begin(), cursors.end(), behind);
+            Cursor &cursor = cursors.back();
+            const Entry candidate = cursor.head;
+            if (++cursor.next == cursor.end)
+            {
+                cursors.pop_back();
+            }
+            else
+            {
+                advance(cursor);
+                std::push_heap(cursors.begin(), cursors.end(), behind);
+            }
+
+            if (!eligible(candidate.movie))
+                continue;
+            if (best.size() < limit)
+            {
+                best.push_back(candidate);
+                std::push_heap(best.begin(), best.end(), ranksBefore);
+            }
+            else if (ranksBefore(candidate, best.front()))
+            {
+                std::pop_heap(best.begin(), best.end(), ranksBefore);
+                best.back() = candidate;
+                std::push_heap(best.begin(), best.end(), ranksBefore);
+            }
+        }
+
+        for (const Entry &entry : best)
+        {
+            visit(entry);
+        }
+    }
+
+private:
+    std::vector<float> movieBoost;
+    std::vector<uint32_t> movieGenres;
+    // Grupos em CSR: groupGenres[g] é o conjunto de gêneros dos filmes de groupEntries[groupOffsets[g]..].
+    std::vector<uint32_t> groupGenres;
+    std::vector<uint32_t> groupOffsets;
+    std::vector<Entry> groupEntries;
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "CsvScanner.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_SCANNER_X86 1
+#endif
+
+using namespace std;
+
+namespace
+{
+    const size_t BLOCK_SIZE = 64;
+
+    uint64_t scalarMask(const char *block, size_t n)
+    {
+        uint64_t mask = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            mask |= static_cast<uint64_t>(block[i] == ',' || block[i] == '\n') << i;
+        }
+        return mask;
+    }
+
+#ifdef CSV_SCANNER_X86
+    __attribute__((target("sse2"))) uint64_t sse2Mask(const char *block)
+    {
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i newline = _mm_set1_epi8('\n');
+        uint64_t mask = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+            const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, newline));
+            mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(hits))) << (i * 16);
+        }
+        return mask;
+    }
+
+    __attribute__((target("avx2"))) uint64_t avx2Mask(const char *block)
+    {
+        const __m256i comma = _mm256_set1_epi8(',');
+        const __m256i newline = _mm256_set1_epi8('\n');
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+        const uint32_t maskLo = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, comma), _mm256_cmpeq_epi8(lo, newline)));
+        const uint32_t maskHi = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, comma), _mm256_cmpeq_epi8(hi, newline)));
+        return static_cast<uint64_t>(maskHi) << 32 | maskLo;
+    }
+#endif
+
+    uint64_t scalarBlockMask(const char *block)
+    {
+        return scalarMask(block, BLOCK_SIZE);
+    }
+
+    struct Kernel
+    {
+        uint64_t (*mask)(const char *);
+        const char *name;
+    };
+
+    Kernel selectKernel()
+    {
+#ifdef CSV_SCANNER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {avx2Mask, "avx2"};
+        if (__builtin_cpu_supports("sse2"))
+            return {sse2Mask, "sse2"};
+#endif
+        return {scalarBlockMask, "scalar"};
+    }
+
+    const Kernel kernel = selectKernel();
+
+    // Inteiro positivo formado só por dígitos (até 9, para não estourar int).
+    inline bool parseId(const char *s, size_t n, int &value)
+    {
+        if (n == 0 || n > 9)
+            return false;
+        int v = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            const unsigned d = static_cast<unsigned>(s[i] - '0');
+            if (d > 9)
+                return false;
+            v = v * 10 + static_cast<int>(d);
+        }
+        value = v;
+        return true;
+    }
+
+    // As notas do MovieLens são meias estrelas ("d.0" / "d.5"); outros formatos decimais
+    // seguem o caminho genérico.
+    inline bool parseRating(const char *s, size_t n, float &value)
+    {
+        if (n == 3 && s[1] == '.')
+        {
+            const unsigned whole = static_cast<unsigned>(s[0] - '0');
+            const unsigned tenth = static_cast<unsigned>(s[2] - '0');
+            if (whole > 9 || tenth > 9)
+                return false;
+            if (tenth == 0 || tenth == 5)
+                value = static_cast<float>(whole) + (tenth ? 0.5f : 0.0f);
+            else
+                value = static_cast<float>(whole) + tenth * 0.1f;
+            return true;
+        }
+        if (n == 1)
+        {
+            const unsigned whole = static_cast<unsigned>(s[0] - '0');
+            if (whole > 9)
+                return false;
+            value = static_cast<float>(whole);
+            return true;
+        }
+
+        size_t i = 0;
+        float v = 0.0f;
+        for (; i < n && s[i] != '.'; i++)
+        {
+            const unsigned d = static_cast<unsigned>(s[i] - '0');
+            if (d > 9)
+                return false;
+            v = v * 10.0f + d;
+        }
+        if (i == 0)
+            return false;
+        float multiplier = 0.1f;
+        for (i++; i < n; i++)
+        {
+            const unsigned d = static_cast<unsigned>(s[i] - '0');
+            if (d > 9)
+                return false;
+            v += d * multiplier;
+            multiplier *= 0.1f;
+        }
+        value = v;
+        return true;
+    }
+}
+
+RatingsCsvScanner::RatingsCsvScanner(const char *begin, const char *end)
+    : data(begin), size(end > begin ? end - begin : 0), windowBase(0), indexedEnd(0),
+      indexes(WINDOW_SIZE + BLOCK_SIZE), indexPos(0), indexCount(0), lineStart(0)
+{
+}
+
+const char *RatingsCsvScanner::kernelName()
+{
+    return kernel.name;
+}
+
+// Estágio 1: converte a próxima janela em máscaras de 64 bytes e grava as posições dos
+// separadores em indexes. Retorna o próximo separador (ou size no fim dos dados).
+size_t RatingsCsvScanner::refill()
+{
+    while (indexedEnd < size)
+    {
+        windowBase = indexedEnd;
+        const size_t windowEnd = min(size, windowBase + WINDOW_SIZE);
+        uint32_t *out = indexes.data();
+        size_t count = 0;
+
+        for (size_t block = windowBase; block < windowEnd; block += BLOCK_SIZE)
+        {
+            const size_t n = windowEnd - block;
+            uint64_t mask = n >= BLOCK_SIZE ? kernel.mask(data + block) : scalarMask(data + block, n);
+            const uint32_t offset = static_cast<uint32_t>(block - windowBase);
+            const size_t found = __builtin_popcountll(mask);
+
+            // Escrita incondicional em grupos de 4 (como no simdjson): evita um desvio mal
+            // previsto por separador; as posições extras são sobrescritas depois.
+            for (size_t k = 0; k < found; k += 4)
+            {
+                out[count + k] = offset + __builtin_ctzll(mask);
+                mask &= mask - 1;
+                out[count + k + 1] = offset + __builtin_ctzll(mask | (1ULL << 63));
+                mask &= mask - 1;
+                out[count + k + 2] = offset + __builtin_ctzll(mask | (1ULL << 63));
+                mask &= mask - 1;
+                out[count + k + 3] = offset + __builtin_ctzll(mask | (1ULL << 63));
+                mask &= mask - 1;
+            }
+            count += found;
+        }
+
+        indexedEnd = windowEnd;
+        indexPos = 0;
+        indexCount = count;
+        if (count > 0)
+            return windowBase + indexes[indexPos++];
+    }
+    return size;
+}
+
+bool RatingsCsvScanner::next(int &userId, int &movieId, float &rating)
+{
+    while (lineStart < size)
+    {
+        const size_t start = lineStart;
+        size_t fields[3];
+        size_t pos = size;
+        int commas = 0;
+
+        // Separadores da linha: as três primeiras vírgulas (o timestamp é opcional) e o '\n' final.
+        while (true)
+        {
+            pos = nextStructural();
+            if (pos >= size || data[pos] == '\n')
+                break;
+            if (commas < 3)
+                fields[commas] = pos;
+            commas++;
+        }
+        lineStart = pos < size ? pos + 1 : size;
+
+        if (commas < 2)
+            continue;
+        if (commas == 2)
+        {
+            // Linha sem timestamp: a nota vai até o fim da linha.
+            fields[2] = pos;
+            if (fields[2] > fields[1] + 1 && data[fields[2] - 1] == '\r')
+                fields[2]--;
+        }
+
+        int u, m;
+        float r;
+        if (!parseId(data + start, fields[0] - start, u) ||
+            !parseId(data + fields[0] + 1, fields[1] - fields[0] - 1, m) ||
+            !parseRating(data + fields[1] + 1, fields[2] - fields[1] - 1, r))
+            continue;
+
+        if (u > 0 && m > 0 && r >= 0.0f && r <= 5.0f)
+        {
+            userId = u;
+            movieId = m;
+            rating = r;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,45 @@
+#ifndef CSV_SCANNER_HPP
+#define CSV_SCANNER_HPP
+
+#include "Config.hpp"
+
+// Leitor das linhas "userId,movieId,rating,timestamp" do ratings.csv no estilo do simdjson:
+// cada bloco de 64 bytes vira uma máscara de bits com as posições de ',' e '\n' (AVX2 ou SSE2,
+// escolhido em tempo de execução), e os campos são lidos entre as posições marcadas.
+class RatingsCsvScanner
+{
+public:
+    RatingsCsvScanner(const char *begin, const char *end);
+
+    // Próxima linha válida (linhas malformadas ou fora dos limites são ignoradas).
+    bool next(int &userId, int &movieId, float &rating);
+
+    // Início da próxima linha ainda não lida.
+    const char *position() const { return data + lineStart; }
+
+    static const char *kernelName();
+
+private:
+    // Estágio 1 indexa uma janela por vez; o estágio 2 (next) consome os índices.
+    static const size_t WINDOW_SIZE = 16 * 1024;
+
+    const char *data;
+    size_t size;
+    size_t windowBase;
+    size_t indexedEnd;
+    std::vector<uint32_t> indexes;
+    size_t indexPos;
+    size_t indexCount;
+    size_t lineStart;
+
+    size_t nextStructural()
+    {
+        if (indexPos < indexCount)
+            return windowBase + indexes[indexPos++];
+        return refill();
+    }
+
+    size_t refill();
+};
+
+#endif
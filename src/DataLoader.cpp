@@ -1,5 +1,8 @@
 
 #include "DataLoader.hpp"
+#include "ModelSnapshot.hpp"
+#include "preProcessament.hpp"
+#include "ThreadPool.hpp"
 
 
 
@@ -12,7 +15,6 @@ using std::min;
 using std::move;
 using std::pair;
 using std::string;
-using std::thread;
 using std::unordered_map;
 using std::vector;
 using std::chrono::duration_cast;
@@ -22,50 +24,25 @@ using std::chrono::milliseconds;
 class DataLoader::Impl
 {
 public:
-    unordered_map<uint32_t, UserProfile> &users;
+    RatingStore &store;
     unordered_map<uint32_t, Movie> &movies;
     unordered_map<string, int> &genreToId;
-    unordered_map<uint32_t, vector<pair<uint32_t, float>>> &movieToUsers;
-    unordered_map<uint32_t, vector<uint32_t>> &genreToMovies;
-    float &globalAvgRating;
-    unordered_map<uint32_t, float> &movieAvgRatings;
-    unordered_map<uint32_t, int> &moviePopularity;
+    vector<vector<uint32_t>> &genreToMovies;
 
-    Impl(unordered_map<uint32_t, UserProfile> &u,
+    Impl(RatingStore &s,
          unordered_map<uint32_t, Movie> &m,
          unordered_map<string, int> &g,
-         unordered_map<uint32_t, vector<pair<uint32_t, float>>> &mtu,
-         unordered_map<uint32_t, vector<uint32_t>> &gtm,
-         float &gar,
-         unordered_map<uint32_t, float> &mar,
-         unordered_map<uint32_t, int> &mp)
-        : users(u), movies(m), genreToId(g), movieToUsers(mtu),
-          genreToMovies(gtm), globalAvgRating(gar),
-          movieAvgRatings(mar), moviePopularity(mp) {}
+         vector<vector<uint32_t>> &gtm)
+        : store(s), movies(m), genreToId(g), genreToMovies(gtm) {}
 
     void loadRatings(const string &filename);
+    void buildRatings(vector<RatingBatch> batches);
     void loadMovies(const string &filename);
     void calculateUserPreferences();
     vector<uint32_t> loadUsersToRecommend(const string &filename);
 
 private:
-    struct alignas(64) ThreadData
-    {
-        unordered_map<uint32_t, UserProfile> users;
-        unordered_map<uint32_t, vector<pair<uint32_t, float>>> movieToUsers;
-        unordered_map<uint32_t, float> movieSums;
-        unordered_map<uint32_t, int> movieCounts;
-        double ratingSum = 0.0;
-        uint64_t ratingCount = 0;
-
-        ThreadData()
-        {
-            users.reserve(10000);
-            movieToUsers.reserve(10000);
-            movieSums.reserve(10000);
-            movieCounts.reserve(10000);
-        }
-    };
+    void buildStore(const vector<RatingBatch> &batches);
 
     inline const char *skipWhitespace(const char *p, const char *end)
     {
@@ -85,15 +62,11 @@ private:
 };
 
 DataLoader::DataLoader(
-    unordered_map<uint32_t, UserProfile> &u,
+    RatingStore &s,
     unordered_map<uint32_t, Movie> &m,
     unordered_map<string, int> &g,
-    unordered_map<uint32_t, vector<pair<uint32_t, float>>> &mtu,
-    unordered_map<uint32_t, vector<uint32_t>> &gtm,
-    float &gar,
-    unordered_map<uint32_t, float> &mar,
-    unordered_map<uint32_t, int> &mp)
-    : pimpl(make_unique<Impl>(u, m, g, mtu, gtm, gar, mar, mp)) {}
+    vector<vector<uint32_t>> &gtm)
+    : pimpl(make_unique<Impl>(s, m, g, gtm)) {}
 
 DataLoader::~DataLoader() = default;
 
@@ -102,6 +75,11 @@ void DataLoader::loadRatings(const string &filename)
     pimpl->loadRatings(filename);
 }
 
+void DataLoader::buildRatings(vector<RatingBatch> batches)
+{
+    pimpl->buildRatings(move(batches));
+}
+
 void DataLoader::loadMovies(const string &filename)
 {
     pimpl->loadMovies(filename);
@@ -114,9 +92,21 @@ vector<uint32_t> DataLoader::loadUsersToRecommend(const string &filename)
 
 void DataLoader::Impl::loadRatings(const string &filename)
 {
+    if (ModelSnapshot::load(Config::SNAPSHOT_FILE, store))
+    {
+        return;
+    }
+
+    // Snapshot com cabeçalho atualizado mas conteúdo inválido (o pré-processamento foi pulado) e
+    // sem input.dat: refaz o pré-processamento a partir do ratings.csv.
     const int fd = open(filename.c_str(), O_RDONLY);
     if (fd == -1)
     {
+        vector<RatingBatch> batches;
+        if (process_ratings_file(&batches, false) == 0)
+        {
+            buildRatings(move(batches));
+        }
         return;
     }
 
@@ -138,49 +128,57 @@ void DataLoader::Impl::loadRatings(const string &filename)
 
     madvise(const_cast<char *>(file_data), sb.st_size, MADV_SEQUENTIAL);
 
-    const int num_threads = min(static_cast<int>(thread::hardware_concurrency()),
+    ThreadPool &pool = ThreadPool::instance();
+    const int num_threads = min(static_cast<int>(pool.concurrency()),
                                 max(1, static_cast<int>(sb.st_size / 5000000)));
 
-    vector<ThreadData> threadData(num_threads);
-    vector<thread> threads;
-    threads.reserve(num_threads);
+    vector<RatingBatch> threadData(num_threads);
+    TaskGroup tasks(pool);
 
     const size_t chunk_size = sb.st_size / num_threads;
     const char *const file_end = file_data + sb.st_size;
 
-    for (int t = 0; t < num_threads; ++t)
+    // Cortes alinhados ao início das linhas; cada pedaço termina onde o seguinte começa.
+    vector<const char *> bounds(num_threads + 1, file_end);
+    bounds[0] = file_data;
+    for (int t = 1; t < num_threads; ++t)
     {
-        const char *chunk_start = file_data + t * chunk_size;
-        const char *chunk_end = (t == num_threads - 1) ? file_end : (chunk_start + chunk_size);
-
-        if (t > 0)
+        const char *start = max(file_data + t * chunk_size, bounds[t - 1]);
+        while (start < file_end && *(start - 1) != '\n')
         {
-            while (chunk_start < chunk_end && *(chunk_start - 1) != '\n')
-            {
-                ++chunk_start;
-            }
+            ++start;
         }
+        bounds[t] = start;
+    }
 
-        threads.emplace_back([this, chunk_start, chunk_end, t, &threadData]()
-                             {
-            ThreadData& data = threadData[t];
+    for (int t = 0; t < num_threads; ++t)
+    {
+        const char *chunk_start = bounds[t];
+        const char *chunk_end = bounds[t + 1];
+
+        tasks.run([this, chunk_start, chunk_end, t, &threadData]()
+                  {
+            RatingBatch& data = threadData[t];
+            data.lineUsers.reserve(10000);
+            data.lineOffsets.reserve(10001);
+            data.movieIds.reserve(1000000);
+            data.ratings.reserve(1000000);
             const char* p = chunk_start;
             
             while (p < chunk_end) {
-                p = skipToNext(p, chunk_end);
-                if (p >= chunk_end) break;
+                if (*p == '\n' || *p == '\r') {
+                    ++p;
+                    continue;
+                }
                 
                 uint32_t userId;
                 const auto [p1, ec1] = std::from_chars(p, chunk_end, userId);
-                if (ec1 != std::errc{}) continue;
+                if (ec1 != std::errc{}) {
+                    p = skipToNext(p, chunk_end);
+                    continue;
+                }
                 p = skipWhitespace(p1, chunk_end);
 
-                UserProfile& user = data.users[userId];
-                user.ratings.reserve(100); 
-                
-                float sumRatings = 0.0f;
-                int ratingsCount = 0;
-
                 while (p < chunk_end && *p != '\n' && *p != '\r') {
                     uint32_t movieId;
                     const auto [p2, ec2] = std::from_chars(p, chunk_end, movieId);
@@ -194,90 +192,124 @@ void DataLoader::Impl::loadRatings(const string &filename)
                     if (ec3 != std::errc{}) break;
                     p = skipWhitespace(p3, chunk_end);
                     
-                    user.ratings.emplace_back(movieId, rating);
-                    data.movieToUsers[movieId].emplace_back(userId, rating);
-                    sumRatings += rating;
-                    data.movieSums[movieId] += rating;
-                    ++data.movieCounts[movieId];
-                    ++ratingsCount;
-                }
-                
-                if (ratingsCount > 0) {
-                    data.ratingSum += sumRatings;
-                    data.ratingCount += ratingsCount;
-                    user.avgRating = sumRatings / ratingsCount;
-                    
-                    if (user.ratings.size() > 1) {
-                        std::sort(user.ratings.begin(), user.ratings.end());
-                    }
+                    data.addRating(movieId, rating);
                 }
+
+                data.endLine(userId);
+                p = skipToNext(p, chunk_end);
             } });
     }
 
-    for (auto &t : threads)
-        t.join();
+    tasks.wait();
     munmap(const_cast<char *>(file_data), sb.st_size);
 
-    size_t totalUsers = 0;
-    unordered_map<uint32_t, size_t> movieRatingCounts;
+    buildRatings(move(threadData));
+}
+
+// Monta a RatingStore a partir de lotes já filtrados (do parser do input.dat ou direto do
+// pré-processamento) e grava o snapshot.
+void DataLoader::Impl::buildRatings(vector<RatingBatch> batches)
+{
+    buildStore(batches);
+    batches.clear();
+    batches.shrink_to_fit();
+
+    ModelSnapshot::save(Config::SNAPSHOT_FILE, store);
+}
+
+void DataLoader::Impl::buildStore(const vector<RatingBatch> &threadData)
+{
+    uint32_t maxUserId = 0;
+    uint32_t maxMovieId = 0;
     for (const auto &data : threadData)
     {
-        totalUsers += data.users.size();
-        for (const auto &[movieId, ratings] : data.movieToUsers)
+        maxUserId = max(maxUserId, data.maxUserId);
+        maxMovieId = max(maxMovieId, data.maxMovieId);
+    }
+
+    vector<uint64_t> userCounts(static_cast<size_t>(maxUserId) + 1, 0);
+    vector<uint8_t> userPresent(static_cast<size_t>(maxUserId) + 1, 0);
+    vector<uint8_t> moviePresent(static_cast<size_t>(maxMovieId) + 1, 0);
+    for (const auto &data : threadData)
+    {
+        for (size_t l = 0; l < data.lineUsers.size(); ++l)
         {
-            movieRatingCounts[movieId] += ratings.size();
+            userPresent[data.lineUsers[l]] = 1;
+            userCounts[data.lineUsers[l]] += data.lineOffsets[l + 1] - data.lineOffsets[l];
+        }
+        for (const uint32_t movieId : data.movieIds)
+        {
+            moviePresent[movieId] = 1;
         }
     }
 
-    users.reserve(totalUsers);
-    movieToUsers.reserve(movieRatingCounts.size());
-    movieAvgRatings.reserve(movieRatingCounts.size());
-    moviePopularity.reserve(movieRatingCounts.size());
+    store = RatingStore();
+    for (uint32_t id = 0; id <= maxUserId; ++id)
+    {
+        if (userPresent[id])
+            store.userIds.push_back(id);
+    }
+    for (uint32_t id = 0; id <= maxMovieId; ++id)
+    {
+        if (moviePresent[id])
+            store.movieIds.push_back(id);
+    }
+    store.buildIdIndex();
 
-    for (const auto &[movieId, count] : movieRatingCounts)
+    const size_t numUsers = store.numUsers();
+    vector<uint64_t> userOffsets(numUsers + 1, 0);
+    for (uint32_t u = 0; u < numUsers; ++u)
     {
-        movieToUsers[movieId].reserve(count);
+        userOffsets[u + 1] = userOffsets[u] + userCounts[store.userIds[u]];
     }
 
-    uint64_t totalRatings = 0;
-    double totalSum = 0.0;
+    const uint64_t numRatings = userOffsets[numUsers];
+    vector<uint32_t> userMovies(numRatings);
+    vector<float> userRatings(numRatings);
 
-    for (auto &data : threadData)
+    vector<uint64_t> cursor(userOffsets.begin(), userOffsets.end() - 1);
+    for (const auto &data : threadData)
     {
-        for (auto &[userId, profile] : data.users)
+        for (size_t l = 0; l < data.lineUsers.size(); ++l)
         {
-            users[userId] = move(profile);
+            uint64_t &pos = cursor[store.userIndex(data.lineUsers[l])];
+            for (uint64_t i = data.lineOffsets[l]; i < data.lineOffsets[l + 1]; ++i, ++pos)
+            {
+                userMovies[pos] = store.movieIndex(data.movieIds[i]);
+                userRatings[pos] = data.ratings[i];
+            }
         }
+    }
 
-        for (auto &[movieId, ratings] : data.movieToUsers)
+    ThreadPool::instance().parallelFor(0, numUsers, 5000, [&](size_t startIdx, size_t endIdx)
+                                       {
+        vector<pair<uint32_t, float>> row;
+        for (size_t u = startIdx; u < endIdx; ++u)
         {
-            auto &target = movieToUsers[movieId];
-            target.insert(target.end(),
-                          std::make_move_iterator(ratings.begin()),
-                          std::make_move_iterator(ratings.end()));
-        }
+            const uint64_t begin = userOffsets[u];
+            const uint64_t end = userOffsets[u + 1];
+            if (std::is_sorted(userMovies.begin() + begin, userMovies.begin() + end))
+                continue;
 
-        totalSum += data.ratingSum;
-        totalRatings += data.ratingCount;
-
-        for (const auto &[movieId, sum] : data.movieSums)
-        {
-            movieAvgRatings[movieId] += sum;
-        }
-        for (const auto &[movieId, count] : data.movieCounts)
-        {
-            moviePopularity[movieId] += count;
-        }
-    }
+            row.clear();
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                row.emplace_back(userMovies[i], userRatings[i]);
+            }
+            std::sort(row.begin(), row.end());
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                userMovies[i] = row[i - begin].first;
+                userRatings[i] = row[i - begin].second;
+            }
+        } });
 
-    globalAvgRating = totalRatings > 0 ? static_cast<float>(totalSum / totalRatings) : 0.0f;
+    store.userLists.assign(userOffsets, userMovies.data(), userRatings.data());
+    userMovies = vector<uint32_t>();
+    userRatings = vector<float>();
 
-    for (auto &[movieId, sum] : movieAvgRatings)
-    {
-        const int count = moviePopularity[movieId];
-        if (count > 0)
-            sum /= count;
-    }
+    store.computeAggregates();
+    store.buildTranspose();
 }
 
 void DataLoader::Impl::loadMovies(const string &filename)
@@ -289,7 +321,7 @@ void DataLoader::Impl::loadMovies(const string &filename)
     }
 
     movies.reserve(65000);
-    genreToMovies.reserve(25);
+    genreToMovies.reserve(32);
 
     string line;
     line.reserve(256);
@@ -319,6 +351,7 @@ void DataLoader::Impl::loadMovies(const string &filename)
         const string genres = line.substr(last_comma + 1);
 
         const uint32_t movieId = std::stoul(movieIdStr);
+        const uint32_t movieIdx = store.movieIndex(movieId);
         Movie &movie = movies[movieId];
         movie.genreBitmask = 0;
         movie.genres.reserve(5);
@@ -340,10 +373,20 @@ void DataLoader::Impl::loadMovies(const string &filename)
 
             const int genreId = genreToId[genre];
             movie.genreBitmask |= (1U << genreId);
-            genreToMovies[genreId].push_back(movieId);
+            if (movieIdx != RatingStore::INVALID_INDEX)
+            {
+                if (genreToMovies.size() <= static_cast<size_t>(genreId))
+                    genreToMovies.resize(genreId + 1);
+                genreToMovies[genreId].push_back(movieIdx);
+            }
 
             pos = actualEnd + 1;
         }
+
+        if (movieIdx != RatingStore::INVALID_INDEX)
+        {
+            store.movieGenres[movieIdx] = movie.genreBitmask;
+        }
     }
 
     calculateUserPreferences();
@@ -351,67 +394,49 @@ void DataLoader::Impl::loadMovies(const string &filename)
 
 void DataLoader::Impl::calculateUserPreferences()
 {
-    vector<UserProfile *> userPtrs;
-    userPtrs.reserve(users.size());
-    for (auto &[userId, profile] : users)
-    {
-        userPtrs.push_back(&profile);
-    }
-
-    const int num_threads = min(static_cast<int>(thread::hardware_concurrency()),
-                                max(1, static_cast<int>(userPtrs.size() / 5000)));
-    vector<thread> threads;
-    threads.reserve(num_threads);
-    const size_t chunk_size = userPtrs.size() / num_threads;
-
-    for (int t = 0; t < num_threads; ++t)
-    {
-        const size_t start_idx = t * chunk_size;
-        const size_t end_idx = (t == num_threads - 1) ? userPtrs.size() : (t + 1) * chunk_size;
-
-        threads.emplace_back([this, &userPtrs, start_idx, end_idx]()
-                             {
-            for (size_t i = start_idx; i < end_idx; ++i) {
-                UserProfile& user = *userPtrs[i];
-                unordered_map<int, float> genreScores;
-                genreScores.reserve(20);
+    const size_t numUsers = store.numUsers();
+
+    ThreadPool::instance().parallelFor(0, numUsers, 5000, [this](size_t start_idx, size_t end_idx)
+                                       {
+            RowBuffer buffer;
+            for (size_t u = start_idx; u < end_idx; ++u) {
+                const RatingRow row = store.userRow(u, buffer);
+                float genreScores[32] = {};
+                uint32_t scoredGenres = 0;
                 
-                for (const auto& [movieId, rating] : user.ratings) {
+                for (size_t i = 0; i < row.size; ++i) {
+                    const float rating = row.ratings[i];
                     if (rating >= Config::MIN_RATING) {
-                        const auto movieIt = movies.find(movieId);
-                        if (movieIt != movies.end()) {
-                            uint32_t movieGenres = movieIt->second.genreBitmask;
-                            for (int g = 0; g < 32 && movieGenres; ++g) {
-                                if (movieGenres & (1U << g)) {
-                                    genreScores[g] += rating - Config::MIN_RATING;
-                                    movieGenres &= ~(1U << g);
-                                }
+                        uint32_t movieGenres = store.movieGenres[row.items[i]];
+                        for (int g = 0; g < 32 && movieGenres; ++g) {
+                            if (movieGenres & (1U << g)) {
+                                genreScores[g] += rating - Config::MIN_RATING;
+                                scoredGenres |= (1U << g);
+                                movieGenres &= ~(1U << g);
                             }
                         }
                     }
                 }
                 
-                if (!genreScores.empty()) {
+                if (scoredGenres) {
                     vector<pair<float, int>> sortedGenres;
-                    sortedGenres.reserve(genreScores.size());
-                    for (const auto& [genreId, score] : genreScores) {
-                        sortedGenres.emplace_back(score, genreId);
+                    sortedGenres.reserve(32);
+                    for (int g = 0; g < 32; ++g) {
+                        if (scoredGenres & (1U << g))
+                            sortedGenres.emplace_back(genreScores[g], g);
                     }
                     
                     const int topN = min(5, static_cast<int>(sortedGenres.size()));
                     std::partial_sort(sortedGenres.begin(), sortedGenres.begin() + topN, 
                                     sortedGenres.end(), std::greater<pair<float, int>>());
                     
-                    user.preferredGenres = 0;
+                    uint32_t preferredGenres = 0;
                     for (int j = 0; j < topN; ++j) {
-                        user.preferredGenres |= (1U << sortedGenres[j].second);
+                        preferredGenres |= (1U << sortedGenres[j].second);
                     }
+                    store.userPreferredGenres[u] = preferredGenres;
                 }
             } });
-    }
-
-    for (auto &t : threads)
-        t.join();
 }
 
 vector<uint32_t> DataLoader::Impl::loadUsersToRecommend(const string &filename)
@@ -4,26 +4,23 @@
 #include "Config.hpp"
 #include "DataLoader.hpp"
 #include "DataStructures.hpp"
+#include "RatingStore.hpp"
 
-struct UserProfile;
 struct Movie;
 
 class DataLoader
 {
 public:
     DataLoader(
-        std::unordered_map<uint32_t, UserProfile> &u,
+        RatingStore &s,
         std::unordered_map<uint32_t, Movie> &m,
         std::unordered_map<std::string, int> &g,
-        std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, float>>> &mtu,
-        std::unordered_map<uint32_t, std::vector<uint32_t>> &gtm,
-        float &gar,
-        std::unordered_map<uint32_t, float> &mar,
-        std::unordered_map<uint32_t, int> &mp);
+        std::vector<std::vector<uint32_t>> &gtm);
 
     ~DataLoader();
 
     void loadRatings(const std::string &filename);
+    void buildRatings(std::vector<RatingBatch> batches);
     void loadMovies(const std::string &filename);
     std::vector<uint32_t> loadUsersToRecommend(const std::string &filename);
 
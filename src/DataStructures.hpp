@@ -9,13 +9,6 @@ struct Movie
     std::vector<std::string> genres;
 };
 
-struct UserProfile
-{
-    std::vector<std::pair<uint32_t, float>> ratings; 
-    float avgRating;
-    uint32_t preferredGenres; 
-};
-
 struct Recommendation
 {
     uint32_t movieId;
@@ -33,4 +26,31 @@ struct Recommendation
     }
 };
 
+// Avaliações agrupadas em linhas por usuário, como no input.dat (um usuário pode aparecer em
+// mais de um lote). Formato intermediário entre o pré-processamento/parser e a RatingStore.
+struct alignas(64) RatingBatch
+{
+    std::vector<uint32_t> lineUsers;
+    std::vector<uint64_t> lineOffsets{0};
+    std::vector<uint32_t> movieIds;
+    std::vector<float> ratings;
+    uint32_t maxUserId = 0;
+    uint32_t maxMovieId = 0;
+
+    void addRating(uint32_t movieId, float rating)
+    {
+        movieIds.push_back(movieId);
+        ratings.push_back(rating);
+        maxMovieId = std::max(maxMovieId, movieId);
+    }
+
+    // Fecha a linha do usuário com as avaliações adicionadas desde a última chamada.
+    void endLine(uint32_t userId)
+    {
+        lineUsers.push_back(userId);
+        lineOffsets.push_back(movieIds.size());
+        maxUserId = std::max(maxUserId, userId);
+    }
+};
+
 #endif 
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "Evaluation.hpp"
+#include "Benchmark.hpp"
+#include "DataLoader.hpp"
+#include "RecommendationEngine.hpp"
+#include "SimilarityCalculator.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+namespace
+{
+    double mean(const vector<double> &values)
+    {
+        double sum = 0.0;
+        size_t count = 0;
+        for (const double value : values)
+        {
+            if (value >= 0.0)
+            {
+                sum += value;
+                ++count;
+            }
+        }
+        return count ? sum / count : 0.0;
+    }
+
+    double percentile(vector<float> values, double p)
+    {
+        if (values.empty())
+            return 0.0;
+        sort(values.begin(), values.end());
+        const size_t rank = static_cast<size_t>(ceil(p / 100.0 * values.size()));
+        return values[min(values.size(), max<size_t>(1, rank)) - 1];
+    }
+
+    bool contains(const vector<uint32_t> &sorted, uint32_t value)
+    {
+        return binary_search(sorted.begin(), sorted.end(), value);
+    }
+}
+
+Evaluation::Evaluation(const RatingStore &f, const vector<uint32_t> &ids, Config::SimilarityMetric m)
+    : full(f), metric(m), userIds(ids) {}
+
+void Evaluation::prepare()
+{
+    holdOut();
+
+    // Gêneros e preferências recalculados sem as notas retiradas.
+    DataLoader loader(store, movies, genreToId, genreToMovies);
+    loader.loadMovies(Config::MOVIES_FILE);
+    contentBoost.build(store);
+
+    exactNeighbors();
+}
+
+// Cada usuário avaliado com pelo menos EVAL_MIN_PROFILE notas perde EVAL_HOLDOUT delas, sorteadas
+// com o próprio userId como semente (a mesma divisão em todas as execuções).
+void Evaluation::holdOut()
+{
+    store.userIds = full.userIds;
+    store.movieIds = full.movieIds;
+    store.buildIdIndex();
+
+    const size_t numUsers = full.numUsers();
+    vector<int32_t> slot(numUsers, -1);
+    for (const uint32_t userId : userIds)
+    {
+        const uint32_t u = full.userIndex(userId);
+        if (u != RatingStore::INVALID_INDEX && slot[u] < 0 && full.userRowSize(u) >= Config::EVAL_MIN_PROFILE)
+        {
+            slot[u] = static_cast<int32_t>(evalUsers.size());
+            evalUsers.push_back(u);
+        }
+    }
+    heldOut.assign(evalUsers.size(), {});
+
+    vector<uint64_t> offsets(numUsers + 1, 0);
+    vector<uint32_t> items;
+    vector<float> ratings;
+    items.reserve(full.numRatings());
+    ratings.reserve(full.numRatings());
+
+    RowBuffer buffer;
+    vector<size_t> order;
+    vector<uint8_t> removed;
+    for (uint32_t u = 0; u < numUsers; ++u)
+    {
+        const RatingRow row = full.userRow(u, buffer);
+        removed.assign(row.size, 0);
+        if (slot[u] >= 0)
+        {
+            order.resize(row.size);
+            iota(order.begin(), order.end(), 0);
+            mt19937 rng(full.userIds[u]);
+            shuffle(order.begin(), order.end(), rng);
+
+            const size_t count = max<size_t>(1, lround(row.size * Config::EVAL_HOLDOUT));
+            vector<uint32_t> &relevant = heldOut[slot[u]];
+            for (size_t k = 0; k < count; ++k)
+            {
+                removed[order[k]] = 1;
+                if (row.ratings[order[k]] >= Config::MIN_RATING)
+                    relevant.push_back(row.items[order[k]]);
+            }
+            sort(relevant.begin(), relevant.end());
+        }
+
+        for (size_t i = 0; i < row.size; ++i)
+        {
+            if (!removed[i])
+            {
+                items.push_back(row.items[i]);
+                ratings.push_back(row.ratings[i]);
+            }
+        }
+        offsets[u + 1] = items.size();
+    }
+
+    store.userLists.assign(offsets, items.data(), ratings.data());
+    store.computeAggregates();
+    store.buildTranspose();
+}
+
+// Vizinhos exatos pelo kNN de UserNeighbors, com a similaridade e os limites de SimilarityCalculator.
+void Evaluation::exactNeighbors()
+{
+    UserNeighbors exact;
+    exact.build(store, evalUsers, metric, Config::EVAL_NEIGHBORS);
+
+    trueNeighbors.assign(evalUsers.size(), {});
+    for (size_t i = 0; i < evalUsers.size(); ++i)
+    {
+        const UserNeighbors::Row row = exact.neighbors(evalUsers[i]);
+        for (size_t k = 0; k < row.size; ++k)
+        {
+            trueNeighbors[i].push_back(row.items[k].user);
+        }
+        sort(trueNeighbors[i].begin(), trueNeighbors[i].end());
+    }
+}
+
+EvaluationResult Evaluation::run(const LSHIndex::Params &params)
+{
+    EvaluationResult result;
+    result.params = params;
+    result.users = evalUsers.size();
+
+    unique_ptr<LSHIndex> index = LSHIndex::create(params);
+    if (!index)
+    {
+        throw invalid_argument("Formato do LSH sem preset compilado");
+    }
+    LSHIndex &lsh = *index;
+    lsh.shareSignatures(signatureSource(params.numHashes, params.seed));
+    const auto indexStart = Benchmark::Clock::now();
+    lsh.indexSignatures();
+    result.indexSeconds = chrono::duration<double>(Benchmark::Clock::now() - indexStart).count();
+
+    // Cache de similaridades novo por configuração, para a latência não herdar pares já calculados.
+    SimilarityCalculator similarityCalc(store, metric);
+    RecommendationEngine engine(store, movies, genreToMovies, similarityCalc, lsh,
+                                itemNeighbors, userNeighbors, contentBoost, genome);
+
+    const size_t n = evalUsers.size();
+    vector<double> precision(n, -1.0);
+    vector<double> recall(n, -1.0);
+    vector<double> candidates(n, 0.0);
+    vector<float> latencies(n, 0.0f);
+
+    ThreadPool::instance().parallelFor(0, n, 1, [&](size_t start, size_t end)
+                                       {
+        for (size_t i = start; i < end; ++i) {
+            const uint32_t u = evalUsers[i];
+
+            const vector<uint32_t> found = lsh.findSimilarCandidates(u, Config::MAX_CANDIDATES * 3);
+            candidates[i] = found.size();
+            if (!trueNeighbors[i].empty()) {
+                size_t hits = 0;
+                for (const uint32_t v : found)
+                    hits += contains(trueNeighbors[i], v);
+                recall[i] = static_cast<double>(hits) / trueNeighbors[i].size();
+            }
+
+            // As similaridades esperam no pool, e a espera pode executar outros usuários: só o
+            // trabalho do próprio usuário entra na latência.
+            const double foreignStart = ThreadPool::foreignSeconds();
+            const auto userStart = Benchmark::Clock::now();
+            const vector<Recommendation> recommendations = engine.recommendForUser(store.userIds[u]);
+            const double elapsed = chrono::duration<double>(Benchmark::Clock::now() - userStart).count();
+            latencies[i] = static_cast<float>(elapsed - (ThreadPool::foreignSeconds() - foreignStart));
+
+            if (!heldOut[i].empty()) {
+                size_t hits = 0;
+                for (const Recommendation &rec : recommendations)
+                    hits += contains(heldOut[i], store.movieIndex(rec.movieId));
+                precision[i] = static_cast<double>(hits) / Config::TOP_K;
+            }
+        } });
+
+    result.precisionAtK = mean(precision);
+    result.neighborRecall = mean(recall);
+    result.meanCandidates = mean(candidates);
+    result.latencyP50 = percentile(latencies, 50);
+    result.latencyP95 = percentile(latencies, 95);
+    return result;
+}
+
+// Assinaturas por número de hashes, calculadas na primeira configuração que as usa.
+const LSHIndex &Evaluation::signatureSource(int numHashes, uint32_t seed)
+{
+    unique_ptr<LSHIndex> &source = signatureSources[numHashes];
+    if (!source)
+    {
+        LSHIndex::Params params;
+        for (const LSHIndex::Params &preset : LSHIndex::presets())
+        {
+            if (preset.numHashes == numHashes)
+            {
+                params = preset;
+                break;
+            }
+        }
+        params.seed = seed;
+        source = LSHIndex::create(params);
+        source->buildSignatures(store);
+    }
+    return *source;
+}
+
+// Formatos compilados (LSHIndex::presets) × tabelas × bandas por tabela × buckets.
+vector<LSHIndex::Params> Evaluation::tuningGrid()
+{
+    vector<LSHIndex::Params> grid;
+    for (const LSHIndex::Params &shape : LSHIndex::presets())
+    {
+        for (const int numTables : {4, 8, 16})
+        {
+            for (const int bandsPerTable : {1, 2, 3})
+            {
+                for (const size_t numBuckets : {size_t(4000), size_t(16000), size_t(64000)})
+                {
+                    LSHIndex::Params params = shape;
+                    params.numTables = numTables;
+                    params.bandsPerTable = bandsPerTable;
+                    params.numBuckets = numBuckets;
+                    if (params.valid())
+                        grid.push_back(params);
+                }
+            }
+        }
+    }
+    return grid;
+}
+
+// As configurações rodam uma de cada vez, com os usuários de cada uma espalhados pelo pool:
+// rodar várias ao mesmo tempo misturaria as latências medidas.
+vector<EvaluationResult> Evaluation::tune(uint32_t seed)
+{
+    vector<EvaluationResult> results;
+    for (LSHIndex::Params params : tuningGrid())
+    {
+        params.seed = seed;
+        results.push_back(run(params));
+    }
+
+    markPareto(results);
+    return results;
+}
+
+void Evaluation::markPareto(vector<EvaluationResult> &results)
+{
+    for (EvaluationResult &candidate : results)
+    {
+        candidate.pareto = none_of(results.begin(), results.end(), [&](const EvaluationResult &other)
+                                   { return other.latencyP50 <= candidate.latencyP50 &&
+                                            other.neighborRecall >= candidate.neighborRecall &&
+                                            (other.latencyP50 < candidate.latencyP50 ||
+                                             other.neighborRecall > candidate.neighborRecall); });
+    }
+}
+
+size_t Evaluation::recommended(const vector<EvaluationResult> &results)
+{
+    size_t best = results.size();
+    size_t mostRecall = 0;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (results[i].neighborRecall > results[mostRecall].neighborRecall)
+            mostRecall = i;
+        if (results[i].neighborRecall >= Config::TUNE_RECALL_TARGET &&
+            (best == results.size() || results[i].latencyP50 < results[best].latencyP50))
+            best = i;
+    }
+    return best < results.size() ? best : mostRecall;
+}
+
+bool Evaluation::writeJson(const string &filename, const vector<EvaluationResult> &results)
+{
+    const filesystem::path path(filename);
+    if (path.has_parent_path())
+        filesystem::create_directories(path.parent_path());
+
+    ofstream out(filename);
+    if (!out.is_open())
+        return false;
+
+    out << fixed << setprecision(6);
+    out << "{\n";
+    out << "  \"holdout\": " << Config::EVAL_HOLDOUT << ",\n";
+    out << "  \"top_k\": " << Config::TOP_K << ",\n";
+    out << "  \"neighbors\": " << Config::EVAL_NEIGHBORS << ",\n";
+    out << "  \"recall_target\": " << Config::TUNE_RECALL_TARGET << ",\n";
+    out << "  \"recommended\": " << (results.empty() ? 0 : recommended(results)) << ",\n";
+    out << "  \"configurations\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const EvaluationResult &r = results[i];
+        out << (i ? ",\n" : "\n") << "    {"
+            << "\"num_hashes\": " << r.params.numHashes << ", "
+            << "\"num_bands\": " << r.params.numBands
+            << ", \"rows_per_band\": " << r.params.rowsPerBand
+            << ", \"num_tables\": " << r.params.numTables
+            << ", \"bands_per_table\": " << r.params.bandsPerTable
+            << ", \"num_buckets\": " << r.params.numBuckets
+            << ", \"signature_bits\": " << r.params.signatureBits
+            << ", \"users\": " << r.users
+            << ", \"precision_at_k\": " << r.precisionAtK
+            << ", \"neighbor_recall\": " << r.neighborRecall
+            << ", \"mean_candidates\": " << r.meanCandidates
+            << ", \"latency_p50\": " << r.latencyP50
+            << ", \"latency_p95\": " << r.latencyP95
+            << ", \"index_seconds\": " << r.indexSeconds
+            << ", \"pareto\": " << (r.pareto ? "true" : "false") << "}";
+    }
+    out << "\n  ]\n";
+    out << "}\n";
+    return out.good();
+}
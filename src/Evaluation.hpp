@@ -0,0 +1,78 @@
+#ifndef EVALUATION_HPP
+#define EVALUATION_HPP
+
+#include "Config.hpp"
+#include "ContentBoost.hpp"
+#include "DataStructures.hpp"
+#include "ItemNeighbors.hpp"
+#include "LSHIndex.hpp"
+#include "RatingStore.hpp"
+#include "TagGenome.hpp"
+#include "UserNeighbors.hpp"
+
+// Resultado de uma configuração do LSH sobre os usuários avaliados.
+struct EvaluationResult
+{
+    LSHIndex::Params params;
+    size_t users = 0;
+    double precisionAtK = 0.0;   // fração dos TOP_K recomendados entre as notas retiradas com nota >= MIN_RATING
+    double neighborRecall = 0.0; // fração dos EVAL_NEIGHBORS vizinhos exatos que o LSH devolve como candidatos
+    double meanCandidates = 0.0;
+    double latencyP50 = 0.0; // segundos por usuário (recommendForUser)
+    double latencyP95 = 0.0;
+    double indexSeconds = 0.0;
+    bool pareto = false; // nenhuma outra configuração é mais rápida (p50) com recall maior ou igual
+};
+
+// Avaliação offline (--evaluate) e ajuste dos parâmetros do LSH (--tune). Uma fração das notas de
+// cada usuário avaliado é retirada; o modelo é reconstruído sem elas, e cada configuração do LSH é
+// medida pela precisão das recomendações contra as notas retiradas, pelo recall dos vizinhos exatos
+// (cosseno da métrica configurada) e pela latência por usuário.
+class Evaluation
+{
+public:
+    Evaluation(const RatingStore &full, const std::vector<uint32_t> &userIds, Config::SimilarityMetric metric);
+
+    // Monta o modelo sem as notas retiradas e os vizinhos exatos.
+    void prepare();
+
+    EvaluationResult run(const LSHIndex::Params &params);
+
+    // Percorre tuningGrid com a semente dada e marca a fronteira de Pareto (latência × recall dos vizinhos).
+    std::vector<EvaluationResult> tune(uint32_t seed = Config::LSH_SEED);
+
+    static std::vector<LSHIndex::Params> tuningGrid();
+
+    // Marca em cada resultado se ele está na fronteira de Pareto do conjunto.
+    static void markPareto(std::vector<EvaluationResult> &results);
+
+    // A mais rápida entre as de recall >= Config::TUNE_RECALL_TARGET; sem nenhuma, a de maior recall.
+    static size_t recommended(const std::vector<EvaluationResult> &results);
+
+    static bool writeJson(const std::string &filename, const std::vector<EvaluationResult> &results);
+
+private:
+    const RatingStore &full;
+    const Config::SimilarityMetric metric;
+    const std::vector<uint32_t> userIds;
+
+    RatingStore store;
+    std::unordered_map<uint32_t, Movie> movies;
+    std::unordered_map<std::string, int> genreToId;
+    std::vector<std::vector<uint32_t>> genreToMovies;
+    ContentBoostIndex contentBoost;
+    ItemNeighbors itemNeighbors; // vazio: a avaliação mede o CF por usuários do LSH
+    UserNeighbors userNeighbors; // vazio: a recomendação usa o LSH avaliado
+    TagGenome genome;            // vazio
+    std::unordered_map<int, std::unique_ptr<LSHIndex>> signatureSources; // por número de hashes
+
+    std::vector<uint32_t> evalUsers;                  // índices densos dos usuários avaliados
+    std::vector<std::vector<uint32_t>> heldOut;       // filmes retirados com nota >= MIN_RATING, ordenados
+    std::vector<std::vector<uint32_t>> trueNeighbors; // EVAL_NEIGHBORS mais similares, ordenados por índice
+
+    void holdOut();
+    void exactNeighbors();
+    const LSHIndex &signatureSource(int numHashes, uint32_t seed);
+};
+
+#endif
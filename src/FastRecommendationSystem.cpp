@@ -1,19 +1,35 @@
 #include "FastRecommendationSystem.hpp"
+#include "Evaluation.hpp"
+#include "ResultWriter.hpp"
+#include "ThreadPool.hpp"
 
 
 using namespace std;
 
-FastRecommendationSystem::FastRecommendationSystem() : globalAvgRating(0.0f)
+FastRecommendationSystem::FastRecommendationSystem(const RunOptions &runOptions, Benchmark &bench)
+    : options(runOptions), benchmark(bench)
 {
-    dataLoader = new DataLoader(
-        users, movies, genreToId, movieToUsers, genreToMovies,
-        globalAvgRating, movieAvgRatings, moviePopularity);
-    similarityCalculator = new SimilarityCalculator(users);
-    lshIndex = new LSHIndex();
+    LSHIndex::Params lshParams;
+    lshParams.numHashes = options.lshHashes;
+    lshParams.numBands = options.lshBands;
+    lshParams.rowsPerBand = options.lshRows;
+    lshParams.signatureBits = options.lshSignatureBits;
+    lshParams.seed = static_cast<uint32_t>(options.lshSeed);
+    lshIndex = LSHIndex::create(lshParams).release();
+    if (!lshIndex)
+    {
+        throw invalid_argument("Formato do LSH sem preset compilado ou bits de assinatura inválidos");
+    }
+
+    dataLoader = new DataLoader(store, movies, genreToId, genreToMovies);
+    similarityCalculator = new SimilarityCalculator(store, options.similarityMetric);
+    itemNeighbors = new ItemNeighbors();
+    userNeighbors = new UserNeighbors();
+    contentBoost = new ContentBoostIndex();
+    tagGenome = new TagGenome();
     recommendationEngine = new RecommendationEngine(
-        users, movies, movieToUsers, genreToMovies,
-        movieAvgRatings, moviePopularity, globalAvgRating,
-        *similarityCalculator, *lshIndex);
+        store, movies, genreToMovies,
+        *similarityCalculator, *lshIndex, *itemNeighbors, *userNeighbors, *contentBoost, *tagGenome);
 }
 
 FastRecommendationSystem::~FastRecommendationSystem()
@@ -22,57 +38,300 @@ FastRecommendationSystem::~FastRecommendationSystem()
     delete similarityCalculator;
     delete recommendationEngine;
     delete lshIndex;
+    delete itemNeighbors;
+    delete userNeighbors;
+    delete contentBoost;
+    delete tagGenome;
 }
 
-void FastRecommendationSystem::loadData()
+void FastRecommendationSystem::loadData(vector<RatingBatch> preprocessed)
 {
-    dataLoader->loadRatings(Config::RATINGS_FILE);
-    dataLoader->loadMovies(Config::MOVIES_FILE);
+    {
+        Benchmark::StageTimer timer(benchmark, "ratings_load");
+        if (!preprocessed.empty())
+            dataLoader->buildRatings(move(preprocessed));
+        else
+            dataLoader->loadRatings(Config::RATINGS_FILE);
+    }
+    {
+        Benchmark::StageTimer timer(benchmark, "movies_load");
+        dataLoader->loadMovies(Config::MOVIES_FILE);
+    }
+    {
+        Benchmark::StageTimer timer(benchmark, "content_boost_build");
+        contentBoost->build(store);
+    }
+    if (options.genome)
+    {
+        Benchmark::StageTimer timer(benchmark, "genome_load");
+        const bool loaded = tagGenome->load(Config::GENOME_FILE, store);
+        if (options.verbose && loaded)
+        {
+            cerr << "genome: " << tagGenome->numMovies() << " filmes, " << tagGenome->numTags()
+                 << " tags (kernel " << TagGenome::kernelName() << ")" << endl;
+        }
+        else if (options.verbose)
+        {
+            cerr << "genome: " << Config::GENOME_FILE << " ausente ou sem filmes conhecidos" << endl;
+        }
+    }
 
-    auto userRatingsForLSH = make_unique<unordered_map<uint32_t, vector<pair<uint32_t, float>>>>();
-    userRatingsForLSH->reserve(users.size());
+    // A avaliação monta o próprio modelo, sem as notas retiradas.
+    if (options.evaluate || options.tune)
+        return;
 
-    for (const auto &[userId, profile] : users)
+    // O modo item a item não consulta o LSH: só a tabela de vizinhos é necessária.
+    if (options.itemBased)
     {
-        (*userRatingsForLSH)[userId] = profile.ratings;
+        Benchmark::StageTimer timer(benchmark, "item_neighbors");
+        if (!itemNeighbors->load(Config::ITEM_NEIGHBORS_FILE, store))
+        {
+            itemNeighbors->build(store);
+            itemNeighbors->save(Config::ITEM_NEIGHBORS_FILE, store);
+        }
+        return;
     }
 
-    lshIndex->buildSignatures(*userRatingsForLSH, Config::NUM_THREADS);
-    lshIndex->indexSignatures();
+    // O kNN exato substitui o LSH; é montado em processRecommendations, com os usuários conhecidos.
+    if (options.exactNeighbors)
+        return;
+
+    {
+        Benchmark::StageTimer timer(benchmark, "signature_build");
+        lshIndex->buildSignatures(store);
+    }
+    {
+        Benchmark::StageTimer timer(benchmark, "index_build");
+        lshIndex->indexSignatures();
+    }
 }
 
 void FastRecommendationSystem::processRecommendations(const string &filename)
 {
     vector<uint32_t> userIds = dataLoader->loadUsersToRecommend(filename);
+    if (options.exactNeighbors && !options.itemBased)
+    {
+        loadUserNeighbors(userIds);
+    }
 
     filesystem::create_directory("outcome");
-    mutex fileMutex;
-    vector<thread> threads;
-    const unsigned int num_threads = std::max(1u, thread::hardware_concurrency());
-    threads.reserve(num_threads);
-    const size_t batch_size = userIds.size() / num_threads;
+    ResultWriter writer(options.binaryOutput ? Config::BINARY_OUTPUT_FILE : Config::OUTPUT_FILE,
+                        options.binaryOutput, options.orderedOutput);
+    if (!writer.isOpen())
+    {
+        return;
+    }
+
+    const auto recommendStart = chrono::steady_clock::now();
+    const vector<vector<size_t>> units = options.batch ? groupByBuckets(userIds) : scheduleByCost(userIds);
+
+    ThreadPool &pool = ThreadPool::instance();
+    const size_t participants = min(pool.concurrency(), max<size_t>(1, units.size()));
+    vector<ThreadTiming> threadTimings(participants);
+    vector<float> latencies(userIds.size(), 0.0f);
+
+    atomic<size_t> cursor(0);
+    const auto batchStart = chrono::steady_clock::now();
+    vector<chrono::steady_clock::time_point> finishedAt(participants, batchStart);
+
+    TaskGroup group(pool);
+    for (size_t t = 0; t < participants; ++t)
+    {
+        group.run([this, t, &units, &userIds, &writer, &cursor, &finishedAt, &threadTimings, &latencies]()
+                  {
+            ThreadTiming &timing = threadTimings[t];
+            while (true) {
+                const size_t u = cursor.fetch_add(1, memory_order_relaxed);
+                if (u >= units.size())
+                    break;
+                const vector<size_t> &unit = units[u];
+
+                if (options.batch) {
+                    // No modo em lote a latência de cada usuário é a do grupo inteiro.
+                    vector<uint32_t> ids;
+                    ids.reserve(unit.size());
+                    for (const size_t j : unit)
+                        ids.push_back(userIds[j]);
+
+                    const double foreignStart = ThreadPool::foreignSeconds();
+                    const auto groupStart = chrono::steady_clock::now();
+                    const vector<vector<Recommendation>> results = recommendationEngine->recommendForUsers(ids);
+                    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - groupStart).count();
+                    const double own = seconds - (ThreadPool::foreignSeconds() - foreignStart);
+                    for (size_t i = 0; i < unit.size(); ++i) {
+                        writer.write(unit[i], ids[i], results[i]);
+                        latencies[unit[i]] = static_cast<float>(own);
+                    }
+                    timing.busySeconds += own;
+                } else {
+                    // A latência e o tempo ocupado descontam o que a thread executou de outros
+                    // usuários enquanto esperava pelas similaridades deste no pool (já contado
+                    // no participante dono).
+                    for (const size_t j : unit) {
+                        const double foreignStart = ThreadPool::foreignSeconds();
+                        const auto userStart = chrono::steady_clock::now();
+                        writer.write(j, userIds[j], recommendForUser(userIds[j]));
+                        const double seconds = chrono::duration<double>(chrono::steady_clock::now() - userStart).count();
+                        const double own = seconds - (ThreadPool::foreignSeconds() - foreignStart);
+                        latencies[j] = static_cast<float>(own);
+                        timing.busySeconds += own;
+                    }
+                }
+                timing.users += unit.size();
+            }
+            finishedAt[t] = chrono::steady_clock::now(); });
+    }
+    group.wait();
 
-    for (unsigned int i = 0; i < num_threads; ++i)
+    const auto batchEnd = chrono::steady_clock::now();
+    for (size_t t = 0; t < participants; ++t)
     {
-        size_t start_idx = i * batch_size;
-        size_t end_idx = (i == num_threads - 1) ? userIds.size() : (i + 1) * batch_size;
-        threads.emplace_back([this, &userIds, &fileMutex, start_idx, end_idx]()
-                             {
-            for (size_t j = start_idx; j < end_idx; ++j) {
-                uint32_t userId = userIds[j];
-                vector<Recommendation> recommendations = recommendForUser(userId);
-                lock_guard<mutex> lock(fileMutex);
-                printRecommendations(userId, recommendations);
-            } });
+        threadTimings[t].idleSeconds = max(0.0, chrono::duration<double>(batchEnd - batchStart).count() - threadTimings[t].busySeconds);
     }
+    benchmark.addStage("recommend", chrono::duration<double>(batchEnd - recommendStart).count());
 
-    for (auto &t : threads)
     {
-        if (t.joinable())
+        Benchmark::StageTimer timer(benchmark, "write");
+        writer.close();
+    }
+
+    if (options.verbose)
+    {
+        for (size_t t = 0; t < participants; ++t)
         {
-            t.join();
+            cerr << "thread " << t << ": " << threadTimings[t].users << " usuarios, ocupada "
+                 << fixed << setprecision(3) << threadTimings[t].busySeconds << "s, ociosa "
+                 << threadTimings[t].idleSeconds << "s (terminou em "
+                 << chrono::duration<double>(finishedAt[t] - batchStart).count() << "s)" << endl;
         }
     }
+
+    const SimilarityCacheStats cacheStats = similarityCalculator->cacheStats();
+    if (options.verbose)
+    {
+        cerr << "cache de similaridades: " << cacheStats.hits << " acertos, " << cacheStats.misses
+             << " faltas, " << cacheStats.evictions << " remocoes" << endl;
+    }
+
+    benchmark.setCacheStats(cacheStats);
+    benchmark.setThreadTimings(move(threadTimings));
+    benchmark.setUserLatencies(move(latencies));
+}
+
+// kNN exato dos usuários a recomendar: lido de USER_NEIGHBORS_FILE quando ainda vale, senão
+// construído e salvo.
+void FastRecommendationSystem::loadUserNeighbors(const vector<uint32_t> &userIds)
+{
+    Benchmark::StageTimer timer(benchmark, "user_neighbors");
+    vector<uint32_t> userIdxs;
+    userIdxs.reserve(userIds.size());
+    for (const uint32_t userId : userIds)
+    {
+        userIdxs.push_back(store.userIndex(userId));
+    }
+
+    if (userNeighbors->load(Config::USER_NEIGHBORS_FILE, store, userIdxs, options.similarityMetric))
+    {
+        if (options.verbose)
+            cerr << "kNN exato: carregado de " << Config::USER_NEIGHBORS_FILE << endl;
+        return;
+    }
+
+    userNeighbors->build(store, move(userIdxs), options.similarityMetric);
+    userNeighbors->save(Config::USER_NEIGHBORS_FILE, store, options.similarityMetric);
+    if (options.verbose)
+    {
+        cerr << "kNN exato: " << userNeighbors->verifiedPairs() << " similaridades verificadas" << endl;
+    }
+}
+
+// Custo estimado de cada usuário: tamanho do perfil x ocupação dos seus buckets LSH.
+vector<uint64_t> FastRecommendationSystem::estimateCosts(const vector<uint32_t> &userIds) const
+{
+    vector<uint64_t> costs(userIds.size(), 0);
+    ThreadPool::instance().parallelFor(0, userIds.size(), 1024, [&](size_t start, size_t end)
+                                       {
+        for (size_t j = start; j < end; ++j) {
+            const uint32_t userIdx = store.userIndex(userIds[j]);
+            if (userIdx == RatingStore::INVALID_INDEX)
+                continue;
+            const uint64_t profile = store.userRowSize(userIdx);
+            costs[j] = profile * max<uint64_t>(1, lshIndex->bucketOccupancy(userIdx));
+        } });
+    return costs;
+}
+
+// Ordena os usuários pelo custo estimado, do maior para o menor, para que os usuários caros
+// não fiquem para o final do lote, e os entrega em blocos de SCHEDULE_CHUNK_SIZE.
+vector<vector<size_t>> FastRecommendationSystem::scheduleByCost(const vector<uint32_t> &userIds) const
+{
+    const vector<uint64_t> costs = estimateCosts(userIds);
+
+    vector<size_t> order(userIds.size());
+    for (size_t j = 0; j < order.size(); ++j)
+    {
+        order[j] = j;
+    }
+    stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b)
+                { return costs[a] > costs[b]; });
+
+    vector<vector<size_t>> units;
+    for (size_t start = 0; start < order.size(); start += Config::SCHEDULE_CHUNK_SIZE)
+    {
+        units.emplace_back(order.begin() + start, order.begin() + min(start + Config::SCHEDULE_CHUNK_SIZE, order.size()));
+    }
+    return units;
+}
+
+// Agrupa os usuários que caem no mesmo bucket da primeira tabela LSH (grupos de até
+// RECOMMEND_GROUP_SIZE); os grupos mais caros são entregues primeiro.
+vector<vector<size_t>> FastRecommendationSystem::groupByBuckets(const vector<uint32_t> &userIds) const
+{
+    const vector<uint64_t> costs = estimateCosts(userIds);
+
+    vector<size_t> keys(userIds.size(), SIZE_MAX);
+    for (size_t j = 0; j < userIds.size(); ++j)
+    {
+        const uint32_t userIdx = store.userIndex(userIds[j]);
+        if (userIdx != RatingStore::INVALID_INDEX)
+            keys[j] = lshIndex->primaryBucket(userIdx);
+    }
+
+    vector<size_t> order(userIds.size());
+    for (size_t j = 0; j < order.size(); ++j)
+    {
+        order[j] = j;
+    }
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                { return keys[a] != keys[b] ? keys[a] < keys[b] : costs[a] > costs[b]; });
+
+    vector<vector<size_t>> groups;
+    vector<uint64_t> groupCosts;
+    for (size_t start = 0; start < order.size(); start += Config::RECOMMEND_GROUP_SIZE)
+    {
+        const size_t end = min(start + Config::RECOMMEND_GROUP_SIZE, order.size());
+        groups.emplace_back(order.begin() + start, order.begin() + end);
+        uint64_t total = 0;
+        for (size_t k = start; k < end; ++k)
+            total += costs[order[k]];
+        groupCosts.push_back(total);
+    }
+
+    vector<size_t> groupOrder(groups.size());
+    for (size_t g = 0; g < groupOrder.size(); ++g)
+    {
+        groupOrder[g] = g;
+    }
+    stable_sort(groupOrder.begin(), groupOrder.end(), [&groupCosts](size_t a, size_t b)
+                { return groupCosts[a] > groupCosts[b]; });
+
+    vector<vector<size_t>> units;
+    units.reserve(groups.size());
+    for (const size_t g : groupOrder)
+    {
+        units.push_back(move(groups[g]));
+    }
+    return units;
 }
 
 vector<Recommendation> FastRecommendationSystem::recommendForUser(uint32_t userId)
@@ -80,22 +339,41 @@ vector<Recommendation> FastRecommendationSystem::recommendForUser(uint32_t userI
     return recommendationEngine->recommendForUser(userId);
 }
 
-void FastRecommendationSystem::printRecommendations(
-    uint32_t userId,
-    const vector<Recommendation> &recommendations)
+bool FastRecommendationSystem::evaluate(const string &filename)
 {
+    Evaluation evaluation(store, dataLoader->loadUsersToRecommend(filename), options.similarityMetric);
+    {
+        Benchmark::StageTimer timer(benchmark, "evaluation_prepare");
+        evaluation.prepare();
+    }
 
-    ofstream resultFile(Config::OUTPUT_FILE, ios::app);
-    if (resultFile.is_open())
+    vector<EvaluationResult> results;
     {
-        resultFile << userId;
-        for (const auto &rec : recommendations)
+        Benchmark::StageTimer timer(benchmark, options.tune ? "tune" : "evaluate");
+        if (options.tune)
+            results = evaluation.tune(lshIndex->parameters().seed);
+        else
         {
-            resultFile << " " << rec.movieId;
+            results.push_back(evaluation.run(lshIndex->parameters()));
+            Evaluation::markPareto(results);
         }
-        resultFile << endl;
     }
-    else
+
+    if (options.verbose)
     {
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const EvaluationResult &r = results[i];
+            if (options.tune && !r.pareto)
+                continue;
+            cerr << "hashes " << r.params.numHashes << ", bandas " << r.params.numBands << "x" << r.params.rowsPerBand
+                 << ", tabelas " << r.params.numTables << "x" << r.params.bandsPerTable
+                 << ", buckets " << r.params.numBuckets << ": precision@" << Config::TOP_K << " "
+                 << fixed << setprecision(4) << r.precisionAtK << ", recall " << r.neighborRecall
+                 << ", p50 " << r.latencyP50 * 1e3 << "ms"
+                 << (i == Evaluation::recommended(results) ? " (recomendada)" : "") << endl;
+        }
     }
-}
\ No newline at end of file
+
+    return Evaluation::writeJson(Config::EVALUATION_FILE, results);
+}
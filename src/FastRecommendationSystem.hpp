@@ -2,49 +2,62 @@
 #define FAST_RECOMMENDATION_SYSTEM_H
 
 #include "Config.hpp"
+#include "Benchmark.hpp"
 #include "DataLoader.hpp"
+#include "RatingStore.hpp"
 #include "SimilarityCalculator.hpp"
 #include "RecommendationEngine.hpp"
 #include "LSHIndex.hpp"
+#include "ItemNeighbors.hpp"
+#include "UserNeighbors.hpp"
+#include "ContentBoost.hpp"
+#include "TagGenome.hpp"
+#include "Options.hpp"
 
 class FastRecommendationSystem
 {
 private:
     
-    std::unordered_map<uint32_t, UserProfile> users;
+    RatingStore store;
     std::unordered_map<uint32_t, Movie> movies;
     std::unordered_map<std::string, int> genreToId;
-
-    
-    std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, float>>> movieToUsers;
-    std::unordered_map<uint32_t, std::vector<uint32_t>> genreToMovies;
-
-    
-    float globalAvgRating;
-    std::unordered_map<uint32_t, float> movieAvgRatings;
-    std::unordered_map<uint32_t, int> moviePopularity;
+    std::vector<std::vector<uint32_t>> genreToMovies;
 
     
     DataLoader *dataLoader;
     SimilarityCalculator *similarityCalculator;
     RecommendationEngine *recommendationEngine;
     LSHIndex *lshIndex;
+    ItemNeighbors *itemNeighbors;
+    UserNeighbors *userNeighbors;
+    ContentBoostIndex *contentBoost;
+    TagGenome *tagGenome;
+
+    RunOptions options;
+    Benchmark &benchmark;
+
+    std::vector<uint64_t> estimateCosts(const std::vector<uint32_t> &userIds) const;
+    std::vector<std::vector<size_t>> scheduleByCost(const std::vector<uint32_t> &userIds) const;
+    std::vector<std::vector<size_t>> groupByBuckets(const std::vector<uint32_t> &userIds) const;
+    void loadUserNeighbors(const std::vector<uint32_t> &userIds);
 
 public:
-    FastRecommendationSystem();
+    FastRecommendationSystem(const RunOptions &options, Benchmark &benchmark);
     ~FastRecommendationSystem();
 
     
-    void loadData();
+    // Usa os lotes do pré-processamento quando houver; senão carrega o snapshot ou o input.dat.
+    void loadData(std::vector<RatingBatch> preprocessed = {});
 
     
     void processRecommendations(const std::string &filename);
 
+    // --evaluate mede a configuração atual do LSH com notas retiradas; --tune percorre a grade de
+    // parâmetros. O relatório vai para Config::EVALUATION_FILE.
+    bool evaluate(const std::string &filename);
+
     
     std::vector<Recommendation> recommendForUser(uint32_t userId);
-
-private:
-    void printRecommendations(uint32_t userId, const std::vector<Recommendation> &recommendations);
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "Intersection.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INTERSECTION_X86 1
+#endif
+
+using namespace std;
+
+namespace
+{
+    const size_t GALLOP_RATIO = 32;
+
+    template <bool Positions>
+    size_t scalarMerge(const uint32_t *a, size_t na, const uint32_t *b, size_t nb,
+                       size_t i, size_t j, size_t found,
+                       uint32_t *posA, uint32_t *posB)
+    {
+        while (i < na && j < nb)
+        {
+            const uint32_t x = a[i];
+            const uint32_t y = b[j];
+            if (x == y)
+            {
+                if (Positions)
+                {
+                    posA[found] = i;
+                    posB[found] = j;
+                }
+                ++found;
+            }
+            i += (x <= y);
+            j += (y <= x);
+        }
+        return found;
+    }
+
+    template <bool Positions>
+    size_t gallop(const uint32_t *small, size_t ns, const uint32_t *large, size_t nl,
+                  uint32_t *posSmall, uint32_t *posLarge)
+    {
+        size_t found = 0;
+        size_t lo = 0;
+        for (size_t i = 0; i < ns && lo < nl; ++i)
+        {
+            const uint32_t x = small[i];
+            if (large[lo] < x)
+            {
+                size_t step = 1;
+                size_t hi = lo + 1;
+                while (hi < nl && large[hi] < x)
+                {
+                    lo = hi;
+                    step <<= 1;
+                    hi = lo + step;
+                }
+                hi = min(hi, nl);
+                lo = lower_bound(large + lo + 1, large + hi, x) - large;
+                if (lo >= nl)
+                    break;
+            }
+            if (large[lo] == x)
+            {
+                if (Positions)
+                {
+                    posSmall[found] = i;
+                    posLarge[found] = lo;
+                }
+                ++found;
+                ++lo;
+            }
+        }
+        return found;
+    }
+
+#ifdef INTERSECTION_X86
+    // Compara um bloco de 8 IDs de cada lista contra todas as 8 posições do outro bloco:
+    // 4 rotações dentro de cada lane de 128 bits, com e sem troca das lanes.
+    template <bool Positions>
+    __attribute__((target("avx2"))) size_t avx2Kernel(const uint32_t *a, size_t na, const uint32_t *b, size_t nb,
+                                                      uint32_t *posA, uint32_t *posB)
+    {
+        size_t i = 0, j = 0, found = 0;
+
+        while (i + 8 <= na && j + 8 <= nb)
+        {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j));
+            const __m256i vs = _mm256_permute2x128_si256(vb, vb, 1);
+
+            int masks[8];
+            masks[0] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, vb)));
+            masks[1] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))));
+            masks[2] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)))));
+            masks[3] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+            masks[4] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, vs)));
+            masks[5] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(0, 3, 2, 1)))));
+            masks[6] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(1, 0, 3, 2)))));
+            masks[7] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(2, 1, 0, 3)))));
+
+            int any = 0;
+            for (int m = 0; m < 8; ++m)
+                any |= masks[m];
+
+            if (Positions)
+            {
+                while (any)
+                {
+                    const int k = __builtin_ctz(any);
+                    any &= any - 1;
+                    int m = 0;
+                    while (!(masks[m] & (1 << k)))
+                        ++m;
+                    const int lane = (k >> 2) ^ (m >> 2);
+                    const int pos = ((k & 3) + (m & 3)) & 3;
+                    posA[found] = i + k;
+                    posB[found] = j + lane * 4 + pos;
+                    ++found;
+                }
+            }
+            else
+            {
+                found += __builtin_popcount(any);
+            }
+
+            const uint32_t lastA = a[i + 7];
+            const uint32_t lastB = b[j + 7];
+            i += (lastA <= lastB) ? 8 : 0;
+            j += (lastB <= lastA) ? 8 : 0;
+        }
+
+        return scalarMerge<Positions>(a, na, b, nb, i, j, found, posA, posB);
+    }
+
+    // Mesmo esquema com blocos de 16: 4 rotações de lanes de 128 bits x 4 rotações internas.
+    template <bool Positions>
+    __attribute__((target("avx512f"))) size_t avx512Kernel(const uint32_t *a, size_t na, const uint32_t *b, size_t nb,
+                                                           uint32_t *posA, uint32_t *posB)
+    {
+        size_t i = 0, j = 0, found = 0;
+
+        while (i + 16 <= na && j + 16 <= nb)
+        {
+            const __m512i va = _mm512_loadu_si512(a + i);
+            const __m512i vb0 = _mm512_loadu_si512(b + j);
+            const __m512i vbs[4] = {
+                vb0,
+                _mm512_maskz_shuffle_i32x4(0xFFFF, vb0, vb0, _MM_SHUFFLE(0, 3, 2, 1)),
+                _mm512_maskz_shuffle_i32x4(0xFFFF, vb0, vb0, _MM_SHUFFLE(1, 0, 3, 2)),
+                _mm512_maskz_shuffle_i32x4(0xFFFF, vb0, vb0, _MM_SHUFFLE(2, 1, 0, 3)),
+            };
+
+            __mmask16 masks[16];
+            for (int t = 0; t < 4; ++t)
+            {
+                const __m512i vb = vbs[t];
+                masks[t * 4 + 0] = _mm512_cmpeq_epi32_mask(va, vb);
+                masks[t * 4 + 1] = _mm512_cmpeq_epi32_mask(va, _mm512_maskz_shuffle_epi32(0xFFFF, vb, _MM_PERM_ADCB));
+                masks[t * 4 + 2] = _mm512_cmpeq_epi32_mask(va, _mm512_maskz_shuffle_epi32(0xFFFF, vb, _MM_PERM_BADC));
+                masks[t * 4 + 3] = _mm512_cmpeq_epi32_mask(va, _mm512_maskz_shuffle_epi32(0xFFFF, vb, _MM_PERM_CBAD));
+            }
+
+            unsigned any = 0;
+            for (int m = 0; m < 16; ++m)
+                any |= masks[m];
+
+            if (Positions)
+            {
+                while (any)
+                {
+                    const int k = __builtin_ctz(any);
+                    any &= any - 1;
+                    int m = 0;
+                    while (!(masks[m] & (1u << k)))
+                        ++m;
+                    const int lane = ((k >> 2) + (m >> 2)) & 3;
+                    const int pos = ((k & 3) + (m & 3)) & 3;
+                    posA[found] = i + k;
+                    posB[found] = j + lane * 4 + pos;
+                    ++found;
+                }
+            }
+            else
+            {
+                found += __builtin_popcount(any);
+            }
+
+            const uint32_t lastA = a[i + 15];
+            const uint32_t lastB = b[j + 15];
+            i += (lastA <= lastB) ? 16 : 0;
+            j += (lastB <= lastA) ? 16 : 0;
+        }
+
+        return scalarMerge<Positions>(a, na, b, nb, i, j, found, posA, posB);
+    }
+#endif
+
+    template <bool Positions>
+    size_t scalarKernel(const uint32_t *a, size_t na, const uint32_t *b, size_t nb,
+                        uint32_t *posA, uint32_t *posB)
+    {
+        return scalarMerge<Positions>(a, na, b, nb, 0, 0, 0, posA, posB);
+    }
+
+    struct Kernels
+    {
+        size_t (*positions)(const uint32_t *, size_t, const uint32_t *, size_t, uint32_t *, uint32_t *);
+        size_t (*count)(const uint32_t *, size_t, const uint32_t *, size_t, uint32_t *, uint32_t *);
+        const char *name;
+    };
+
+    Kernels selectKernels()
+    {
+#ifdef INTERSECTION_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return {avx512Kernel<true>, avx512Kernel<false>, "avx512"};
+        if (__builtin_cpu_supports("avx2"))
+            return {avx2Kernel<true>, avx2Kernel<false>, "avx2"};
+#endif
+        return {scalarKernel<true>, scalarKernel<false>, "scalar"};
+    }
+
+    const Kernels kernels = selectKernels();
+}
+
+size_t Intersection::positions(const uint32_t *a, size_t na,
+                               const uint32_t *b, size_t nb,
+                               uint32_t *posA, uint32_t *posB)
+{
+    if (na == 0 || nb == 0)
+        return 0;
+    if (na * GALLOP_RATIO < nb)
+        return gallop<true>(a, na, b, nb, posA, posB);
+    if (nb * GALLOP_RATIO < na)
+        return gallop<true>(b, nb, a, na, posB, posA);
+    return kernels.positions(a, na, b, nb, posA, posB);
+}
+
+size_t Intersection::count(const uint32_t *a, size_t na,
+                           const uint32_t *b, size_t nb)
+{
+    if (na == 0 || nb == 0)
+        return 0;
+    if (na * GALLOP_RATIO < nb)
+        return gallop<false>(a, na, b, nb, nullptr, nullptr);
+    if (nb * GALLOP_RATIO < na)
+        return gallop<false>(b, nb, a, na, nullptr, nullptr);
+    return kernels.count(a, na, b, nb, nullptr, nullptr);
+}
+
+const char *Intersection::kernelName()
+{
+    return kernels.name;
+}
@@ -0,0 +1,22 @@
+#ifndef INTERSECTION_HPP
+#define INTERSECTION_HPP
+
+#include "Config.hpp"
+
+// Interseção de listas de IDs estritamente crescentes (linhas da RatingStore).
+// A implementação (AVX-512, AVX2 ou escalar) é escolhida em tempo de execução; listas com
+// tamanhos muito diferentes usam busca galopante na lista maior.
+namespace Intersection
+{
+    // Escreve em posA/posB as posições dos itens comuns (capacidade mínima: min(na, nb)).
+    size_t positions(const uint32_t *a, size_t na,
+                     const uint32_t *b, size_t nb,
+                     uint32_t *posA, uint32_t *posB);
+
+    size_t count(const uint32_t *a, size_t na,
+                 const uint32_t *b, size_t nb);
+
+    const char *kernelName();
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include "ItemNeighbors.hpp"
+#include "NeighborsFile.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+namespace
+{
+    const char NEIGHBORS_MAGIC[8] = {'M', 'R', 'I', 'T', 'E', 'M', 'N', 'B'};
+    const uint32_t NEIGHBORS_VERSION = 2;
+
+    struct TableParams
+    {
+        uint64_t numMovies;
+        uint64_t numRatings;
+        uint64_t maxProfile;
+        uint32_t neighborsPerMovie;
+        uint32_t minCoraters;
+    };
+
+    TableParams tableParams(const RatingStore &store)
+    {
+        TableParams params{};
+        params.numMovies = store.numMovies();
+        params.numRatings = store.numRatings();
+        params.maxProfile = Config::ITEM_MAX_PROFILE;
+        params.neighborsPerMovie = Config::ITEM_NEIGHBORS;
+        params.minCoraters = Config::ITEM_MIN_CORATERS;
+        return params;
+    }
+
+    // Usuários acima de ITEM_MAX_PROFILE ficam fora tanto dos produtos quanto das normas.
+    inline bool includedInCooccurrence(const RatingStore &store, uint32_t u)
+    {
+        return store.userRowSize(u) <= Config::ITEM_MAX_PROFILE;
+    }
+}
+
+void ItemNeighbors::build(const RatingStore &store)
+{
+    const size_t numMovies = store.numMovies();
+    ThreadPool &pool = ThreadPool::instance();
+
+    vector<float> norms(numMovies, 0.0f);
+    pool.parallelFor(0, numMovies, 256, [&](size_t start, size_t end)
+                     {
+        RowBuffer buffer;
+        for (size_t m = start; m < end; ++m) {
+            const RatingRow column = store.movieColumn(m, buffer);
+            double sum = 0.0;
+            for (size_t k = 0; k < column.size; ++k) {
+                const uint32_t u = column.items[k];
+                if (!includedInCooccurrence(store, u))
+                    continue;
+                const float deviation = column.ratings[k] - store.userAvgRating[u];
+                sum += deviation * deviation;
+            }
+            norms[m] = static_cast<float>(sqrt(sum));
+        } });
+
+    // Cada filme percorre os perfis de quem o avaliou e acumula, em arrays densos por thread,
+    // o produto dos desvios com todos os filmes co-avaliados.
+    const size_t slotsPerMovie = Config::ITEM_NEIGHBORS;
+    vector<Neighbor> slots(numMovies * slotsPerMovie);
+    vector<uint32_t> counts(numMovies, 0);
+    pool.parallelFor(0, numMovies, 64, [&](size_t start, size_t end)
+                     {
+        thread_local vector<float> dots;
+        thread_local vector<uint32_t> coraters;
+        thread_local vector<uint32_t> touched;
+        thread_local vector<Neighbor> candidates;
+        if (dots.size() != numMovies) {
+            dots.assign(numMovies, 0.0f);
+            coraters.assign(numMovies, 0);
+        }
+        RowBuffer columnBuffer;
+        RowBuffer rowBuffer;
+
+        for (size_t m = start; m < end; ++m) {
+            if (norms[m] == 0.0f)
+                continue;
+
+            const RatingRow column = store.movieColumn(m, columnBuffer);
+            for (size_t k = 0; k < column.size; ++k) {
+                const uint32_t u = column.items[k];
+                if (!includedInCooccurrence(store, u))
+                    continue;
+                const float userAvg = store.userAvgRating[u];
+                const float deviation = column.ratings[k] - userAvg;
+
+                const RatingRow row = store.userRow(u, rowBuffer);
+                for (size_t i = 0; i < row.size; ++i) {
+                    const uint32_t j = row.items[i];
+                    if (coraters[j]++ == 0)
+                        touched.push_back(j);
+                    dots[j] += deviation * (row.ratings[i] - userAvg);
+                }
+            }
+
+            candidates.clear();
+            for (const uint32_t j : touched) {
+                if (j != m && coraters[j] >= static_cast<uint32_t>(Config::ITEM_MIN_CORATERS) && norms[j] > 0.0f) {
+                    const float similarity = dots[j] / (norms[m] * norms[j]);
+                    if (similarity > 0.0f)
+                        candidates.push_back({j, similarity});
+                }
+                dots[j] = 0.0f;
+                coraters[j] = 0;
+            }
+            touched.clear();
+
+            const size_t keep = min(slotsPerMovie, candidates.size());
+            partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(),
+                         [](const Neighbor &a, const Neighbor &b)
+                         { return a.similarity != b.similarity ? a.similarity > b.similarity : a.movie < b.movie; });
+            copy(candidates.begin(), candidates.begin() + keep, slots.begin() + m * slotsPerMovie);
+            counts[m] = static_cast<uint32_t>(keep);
+        } });
+
+    offsets.assign(numMovies + 1, 0);
+    for (size_t m = 0; m < numMovies; ++m)
+    {
+        offsets[m + 1] = offsets[m] + counts[m];
+    }
+    entries.resize(offsets[numMovies]);
+    for (size_t m = 0; m < numMovies; ++m)
+    {
+        copy(slots.begin() + m * slotsPerMovie, slots.begin() + m * slotsPerMovie + counts[m],
+             entries.begin() + offsets[m]);
+    }
+}
+
+bool ItemNeighbors::load(const string &filename, const RatingStore &store)
+{
+    const bool ok = NeighborsFile::load(filename, NEIGHBORS_MAGIC, NEIGHBORS_VERSION, tableParams(store),
+                                        [&](NeighborsFile::Reader &in, uint64_t numEntries)
+                                        {
+        if (!in.fits<Neighbor>(numEntries))
+            return false;
+        offsets.resize(store.numMovies() + 1);
+        entries.resize(numEntries);
+        return in.read(offsets) && in.read(entries) && NeighborsFile::validOffsets(offsets, numEntries) &&
+               all_of(entries.begin(), entries.end(), [&](const Neighbor &neighbor)
+                      { return neighbor.movie < store.numMovies(); }); });
+
+    if (!ok)
+    {
+        offsets.clear();
+        entries.clear();
+    }
+    return ok;
+}
+
+bool ItemNeighbors::save(const string &filename, const RatingStore &store) const
+{
+    if (empty())
+    {
+        return false;
+    }
+
+    return NeighborsFile::save(filename, NEIGHBORS_MAGIC, NEIGHBORS_VERSION, tableParams(store), entries.size(),
+                               [this](NeighborsFile::Writer &out)
+                               { return out.write(offsets) && out.write(entries); });
+}
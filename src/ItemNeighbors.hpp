@@ -0,0 +1,44 @@
+#ifndef ITEM_NEIGHBORS_HPP
+#define ITEM_NEIGHBORS_HPP
+
+#include "Config.hpp"
+#include "RatingStore.hpp"
+
+// Tabela esparsa item-item: para cada filme, os Config::ITEM_NEIGHBORS vizinhos mais similares
+// (cosseno ajustado pela média de cada usuário), em CSR e ordenados por similaridade decrescente.
+// Construída a partir das colunas da RatingStore e persistida em Config::ITEM_NEIGHBORS_FILE.
+class ItemNeighbors
+{
+public:
+    struct Neighbor
+    {
+        uint32_t movie;
+        float similarity;
+    };
+
+    struct Row
+    {
+        const Neighbor *items;
+        size_t size;
+    };
+
+    bool empty() const { return offsets.empty(); }
+
+    Row neighbors(uint32_t movieIdx) const
+    {
+        return {entries.data() + offsets[movieIdx], offsets[movieIdx + 1] - offsets[movieIdx]};
+    }
+
+    void build(const RatingStore &store);
+
+    // Falha se o arquivo não existir, estiver desatualizado ou tiver outros parâmetros.
+    bool load(const std::string &filename, const RatingStore &store);
+
+    bool save(const std::string &filename, const RatingStore &store) const;
+
+private:
+    std::vector<uint64_t> offsets;
+    std::vector<Neighbor> entries;
+};
+
+#endif
@@ -1,293 +1,600 @@
 #include "LSHIndex.hpp"
+#include "ThreadPool.hpp"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MINHASH_X86 1
+#endif
 
 using namespace std;
 
-LSHIndex::LSHIndex() : rng(std::random_device{}())
+namespace
 {
-    tables.resize(Config::NUM_TABLES);
+    // Linha da matriz de hashes arredondada para múltiplos de 16 lanes (um registrador AVX-512).
+    constexpr size_t hashStride(int hashes)
+    {
+        return (static_cast<size_t>(hashes) + 15) / 16 * 16;
+    }
+
+    // out[h] = min sobre os itens do perfil de hashes[item * STRIDE + h].
+    using MinReduceFn = void (*)(const uint32_t *hashes, const uint32_t *items, size_t n, uint32_t *out);
 
-    
-    bandHashParams.resize(Config::NUM_TABLES);
-    for (int t = 0; t < Config::NUM_TABLES; t++)
+    template <size_t STRIDE>
+    void minReduceScalar(const uint32_t *hashes, const uint32_t *items, size_t n, uint32_t *out)
     {
-        bandHashParams[t].resize(Config::NUM_BANDS);
-        for (int b = 0; b < Config::NUM_BANDS; b++)
+        fill(out, out + STRIDE, UINT32_MAX);
+        for (size_t i = 0; i < n; i++)
         {
-            uniform_int_distribution<uint32_t> dist(1, Config::LARGE_PRIME - 1);
-            bandHashParams[t][b].a = dist(rng);
-            bandHashParams[t][b].b = dist(rng);
+            const uint32_t *row = hashes + static_cast<size_t>(items[i]) * STRIDE;
+            for (size_t h = 0; h < STRIDE; h++)
+            {
+                out[h] = min(out[h], row[h]);
+            }
         }
     }
-}
-
-void LSHIndex::buildSignatures(
-    const unordered_map<uint32_t, vector<pair<uint32_t, float>>> &userRatings,
-    int numThreads)
-{
-    
-    auto hashFunctions = generateHashFunctions();
 
-    
-    unordered_set<uint32_t> allMovies;
-    for (const auto &[userId, ratings] : userRatings)
+#ifdef MINHASH_X86
+    template <size_t STRIDE>
+    __attribute__((target("avx2"))) void minReduceAvx2(const uint32_t *hashes, const uint32_t *items, size_t n, uint32_t *out)
     {
-        for (const auto &[movieId, _] : ratings)
+        const size_t VECTORS = STRIDE / 8;
+        __m256i acc[VECTORS];
+        for (size_t v = 0; v < VECTORS; v++)
+            acc[v] = _mm256_set1_epi32(-1);
+
+        for (size_t i = 0; i < n; i++)
         {
-            allMovies.insert(movieId);
+            const uint32_t *row = hashes + static_cast<size_t>(items[i]) * STRIDE;
+            for (size_t v = 0; v < VECTORS; v++)
+                acc[v] = _mm256_min_epu32(acc[v], _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + v * 8)));
         }
-    }
 
-    unordered_map<uint32_t, vector<uint32_t>> precomputedHashes;
-    precomputedHashes.reserve(allMovies.size());
+        for (size_t v = 0; v < VECTORS; v++)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + v * 8), acc[v]);
+    }
 
-    for (uint32_t movieId : allMovies)
+    template <size_t STRIDE>
+    __attribute__((target("avx512f"))) void minReduceAvx512(const uint32_t *hashes, const uint32_t *items, size_t n, uint32_t *out)
     {
-        vector<uint32_t> hashes(Config::NUM_HASH_FUNCTIONS);
-        for (int h = 0; h < Config::NUM_HASH_FUNCTIONS; h++)
+        const size_t VECTORS = STRIDE / 16;
+        __m512i acc[VECTORS];
+        for (size_t v = 0; v < VECTORS; v++)
+            acc[v] = _mm512_maskz_set1_epi32(0xFFFF, -1);
+
+        for (size_t i = 0; i < n; i++)
         {
-            hashes[h] = (hashFunctions[h].first * movieId +
-                         hashFunctions[h].second) %
-                        Config::LARGE_PRIME;
+            const uint32_t *row = hashes + static_cast<size_t>(items[i]) * STRIDE;
+            for (size_t v = 0; v < VECTORS; v++)
+                acc[v] = _mm512_maskz_min_epu32(0xFFFF, acc[v], _mm512_loadu_si512(row + v * 16));
         }
-        precomputedHashes[movieId] = move(hashes);
+
+        for (size_t v = 0; v < VECTORS; v++)
+            _mm512_storeu_si512(out + v * 16, acc[v]);
     }
+#endif
 
-    vector<pair<uint32_t, const vector<pair<uint32_t, float>> *>> userVector;
-    userVector.reserve(userRatings.size());
-    for (const auto &[userId, ratings] : userRatings)
+    template <size_t STRIDE>
+    MinReduceFn selectMinReduce()
     {
-        userVector.emplace_back(userId, &ratings);
+#ifdef MINHASH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return minReduceAvx512<STRIDE>;
+        if (__builtin_cpu_supports("avx2"))
+            return minReduceAvx2<STRIDE>;
+#endif
+        return minReduceScalar<STRIDE>;
     }
 
-    
-    const size_t chunkSize = (userVector.size() + numThreads - 1) / numThreads;
-    vector<future<vector<MinHashSignature>>> futures;
+    template <size_t STRIDE>
+    const MinReduceFn minReduce = selectMinReduce<STRIDE>();
 
-    for (int t = 0; t < numThreads; t++)
+    // Assinaturas e Jaccard estimado para HASHES funções; o banding fica em BandedIndex.
+    template <int HASHES>
+    class MinHashIndex : public LSHIndex
     {
-        size_t startIdx = t * chunkSize;
-        size_t endIdx = min(startIdx + chunkSize, userVector.size());
+    public:
+        using Signature = MinHashSignature<HASHES>;
 
-        if (startIdx < userVector.size())
+        explicit MinHashIndex(const Params &p) : LSHIndex(p) {}
+
+        void buildSignatures(const RatingStore &store) override;
+
+        bool shareSignatures(const LSHIndex &other) override
         {
-            futures.push_back(async(launch::async, [&, startIdx, endIdx]()
-                                    {
-                vector<MinHashSignature> localSignatures;
-                localSignatures.reserve(endIdx - startIdx);
-                
-                for (size_t i = startIdx; i < endIdx; i++) {
-                    uint32_t userId = userVector[i].first;
-                    const auto& ratings = *userVector[i].second;
-                    
-                    MinHashSignature sig(userId);
-                    
-                    for (int h = 0; h < Config::NUM_HASH_FUNCTIONS; h++) {
-                        sig.signature[h] = UINT32_MAX;
-                    }
-                    
-                    for (const auto& [movieId, _] : ratings) {
-                        const auto& movieHashes = precomputedHashes.at(movieId);
-                        for (int h = 0; h < Config::NUM_HASH_FUNCTIONS; h++) {
-                            sig.signature[h] = min(sig.signature[h], movieHashes[h]);
-                        }
-                    }
-                    
-                    localSignatures.push_back(move(sig));
-                }
-                return localSignatures; }));
+            const MinHashIndex *source = dynamic_cast<const MinHashIndex *>(&other);
+            if (!source)
+                return false;
+            signatures = source->signatures;
+            return true;
         }
-    }
 
-    
-    {
-        lock_guard<mutex> lock(indexMutex);
-        for (auto &future : futures)
+        float estimateJaccardSimilarity(uint32_t user1, uint32_t user2) const override
         {
-            auto localSigs = future.get();
-            for (auto &sig : localSigs)
+            if (user1 >= numSignatures() || user2 >= numSignatures())
             {
-                signatures[sig.userId] = move(sig);
+                return 0.0f;
             }
+            float estimate = 0.0f;
+            withSignatureBits([&](auto bits)
+                              { estimate = similarity<decltype(bits)::value>(user1, user2); });
+            return estimate;
         }
-    }
-}
 
-void LSHIndex::indexSignatures()
-{
-    for (auto &table : tables)
+    protected:
+        // Matriz contígua numUsers x HASHES, compartilhada entre índices com bandings diferentes.
+        std::shared_ptr<const std::vector<Signature>> signatures;
+
+        // Os BITS bits mais baixos de cada hash, em palavras de 64 bits (params.signatureBits > 0).
+        // Um campo nunca cruza palavras; o preenchimento final é zero nas duas assinaturas.
+        std::vector<uint64_t> packed;
+
+        size_t numSignatures() const { return signatures ? signatures->size() : 0; }
+
+        static constexpr size_t packedWords(int bits) { return (static_cast<size_t>(HASHES) * bits + 63) / 64; }
+
+        void packSignatures();
+
+        // Chama visit com std::integral_constant<int, signatureBits>, para os laços verem b constante.
+        template <typename Visit>
+        void withSignatureBits(Visit visit) const
+        {
+            switch (params.signatureBits)
+            {
+            case 1:
+                visit(std::integral_constant<int, 1>());
+                break;
+            case 2:
+                visit(std::integral_constant<int, 2>());
+                break;
+            case 4:
+                visit(std::integral_constant<int, 4>());
+                break;
+            default:
+                visit(std::integral_constant<int, 0>());
+                break;
+            }
+        }
+
+        // Jaccard estimado pelas assinaturas completas (BITS = 0) ou pelas b-bit. Com b bits, dois
+        // hashes diferentes coincidem com probabilidade 2^-b, então P(match) = 2^-b + (1 - 2^-b) J
+        // e J = (P - 2^-b) / (1 - 2^-b).
+        template <int BITS>
+        float similarity(uint32_t user1, uint32_t user2) const
+        {
+            if constexpr (BITS == 0)
+            {
+                // Limite fixo: o laço é desenrolado e vira comparações vetoriais.
+                const Signature &sig1 = (*signatures)[user1];
+                const Signature &sig2 = (*signatures)[user2];
+                int matches = 0;
+                for (int i = 0; i < HASHES; i++)
+                {
+                    matches += sig1[i] == sig2[i];
+                }
+                return (float)matches / HASHES;
+            }
+            else
+            {
+                constexpr size_t WORDS = packedWords(BITS);
+                const uint64_t *words1 = &packed[user1 * WORDS];
+                const uint64_t *words2 = &packed[user2 * WORDS];
+                int mismatches = 0;
+                for (size_t w = 0; w < WORDS; w++)
+                {
+                    // Dobra cada campo de BITS bits no seu bit mais baixo.
+                    uint64_t diff = words1[w] ^ words2[w];
+                    if constexpr (BITS >= 2)
+                        diff |= diff >> 1;
+                    if constexpr (BITS >= 4)
+                        diff |= diff >> 2;
+                    constexpr uint64_t LOW = BITS == 1 ? ~0ULL : BITS == 2 ? 0x5555555555555555ULL : 0x1111111111111111ULL;
+                    mismatches += __builtin_popcountll(diff & LOW);
+                }
+                constexpr float COLLISION = 1.0f / (1 << BITS);
+                const float matches = (float)(HASHES - mismatches) / HASHES;
+                return max(0.0f, (matches - COLLISION) / (1.0f - COLLISION));
+            }
+        }
+    };
+
+    template <int HASHES>
+    void MinHashIndex<HASHES>::packSignatures()
     {
-        table.clear();
-        table.reserve(signatures.size() * Config::NUM_BANDS / 100);
+        const int bits = params.signatureBits;
+        if (bits == 0 || !signatures)
+        {
+            packed.clear();
+            packed.shrink_to_fit();
+            return;
+        }
+
+        const size_t words = packedWords(bits);
+        const size_t numUsers = numSignatures();
+        const uint32_t mask = (1u << bits) - 1;
+        packed.assign(numUsers * words, 0);
+        ThreadPool::instance().parallelFor(0, numUsers, 4096, [&](size_t startIdx, size_t endIdx)
+                                           {
+            for (size_t u = startIdx; u < endIdx; u++) {
+                const Signature &sig = (*signatures)[u];
+                uint64_t *row = &packed[u * words];
+                for (int h = 0; h < HASHES; h++) {
+                    const size_t bit = static_cast<size_t>(h) * bits;
+                    row[bit / 64] |= static_cast<uint64_t>(sig[h] & mask) << (bit % 64);
+                }
+            } });
     }
 
-    const int BANDS_PER_TABLE = 3;
+    template <int HASHES>
+    void MinHashIndex<HASHES>::buildSignatures(const RatingStore &store)
+    {
+        constexpr size_t STRIDE = hashStride(HASHES);
+        auto hashFunctions = generateHashFunctions(HASHES);
+
+        // Matriz densa filme x hash, com linhas de STRIDE lanes (as sobras ficam em UINT32_MAX).
+        const size_t numMovies = store.numMovies();
+        vector<uint32_t> movieHashes(numMovies * STRIDE, UINT32_MAX);
+        ThreadPool::instance().parallelFor(0, numMovies, 4096, [&](size_t startIdx, size_t endIdx)
+                                           {
+            for (size_t m = startIdx; m < endIdx; m++) {
+                const uint64_t movieId = store.movieIds[m];
+                uint32_t *row = &movieHashes[m * STRIDE];
+                for (int h = 0; h < HASHES; h++) {
+                    row[h] = static_cast<uint32_t>((hashFunctions[h].first * movieId + hashFunctions[h].second) >> 32);
+                }
+            } });
+
+        const size_t numUsers = store.numUsers();
+        auto built = make_shared<vector<Signature>>(numUsers);
+
+        ThreadPool::instance().parallelFor(0, numUsers, 1024, [&](size_t startIdx, size_t endIdx)
+                                           {
+            alignas(64) uint32_t lanes[STRIDE];
+            RowBuffer buffer;
+            for (size_t u = startIdx; u < endIdx; u++) {
+                const RatingRow row = store.userItems(u, buffer);
+                minReduce<STRIDE>(movieHashes.data(), row.items, row.size, lanes);
+                copy(lanes, lanes + HASHES, (*built)[u].begin());
+            } });
+        signatures = move(built);
+    }
 
-    for (const auto &[userId, sig] : signatures)
+    template <int HASHES, int BANDS, int ROWS>
+    class BandedIndex final : public MinHashIndex<HASHES>
     {
-        for (int tableIdx = 0; tableIdx < Config::NUM_TABLES; tableIdx++)
+        static_assert(BANDS * ROWS <= HASHES, "bandas x linhas maior que o número de hashes");
+
+        using Base = MinHashIndex<HASHES>;
+        using typename Base::Signature;
+        using Bucket = typename LSHIndex::Bucket;
+
+    public:
+        explicit BandedIndex(const LSHIndex::Params &p) : Base(p) {}
+
+        void indexSignatures() override;
+
+        vector<uint32_t> findSimilarCandidates(uint32_t userId, int maxCandidates) const override;
+
+        size_t bucketOccupancy(uint32_t userId) const override
         {
-            int startBand = (tableIdx * BANDS_PER_TABLE) % Config::NUM_BANDS;
+            if (userId >= this->numSignatures() || this->bucketOffsets.empty())
+            {
+                return 0;
+            }
+
+            size_t occupancy = 0;
+            for (int tableIdx = 0; tableIdx < this->params.numTables; tableIdx++)
+            {
+                occupancy += this->bucket(tableIdx, tableHash((*this->signatures)[userId], tableIdx)).size;
+            }
+            return occupancy;
+        }
+
+        size_t primaryBucket(uint32_t userId) const override
+        {
+            if (userId >= this->numSignatures() || this->bucketOffsets.empty())
+            {
+                return this->params.numBuckets;
+            }
+            return tableHash((*this->signatures)[userId], 0);
+        }
+
+    private:
+        size_t tableHash(const Signature &sig, int tableIdx) const
+        {
+            int startBand = (tableIdx * this->params.bandsPerTable) % BANDS;
             size_t combinedHash = 0;
-            for (int i = 0; i < BANDS_PER_TABLE; i++)
+            for (int i = 0; i < this->params.bandsPerTable; i++)
             {
-                int bandIdx = (startBand + i) % Config::NUM_BANDS;
+                int bandIdx = (startBand + i) % BANDS;
                 size_t bandHash = hashBand(sig, bandIdx, tableIdx);
                 combinedHash = (combinedHash << 16) ^ bandHash;
             }
 
-            size_t finalHash = combinedHash % 4000;
-            tables[tableIdx][finalHash].push_back(userId);
+            return combinedHash % this->params.numBuckets;
         }
-    }
-}
 
-vector<uint32_t> LSHIndex::findSimilarCandidates(uint32_t userId, int maxCandidates) const
-{
-    lock_guard<mutex> lock(indexMutex);
+        // ROWS constante: o laço é desenrolado e as constantes do módulo são dobradas.
+        size_t hashBand(const Signature &sig, int bandIdx, int tableIdx) const
+        {
+            const LSHIndex::HashParams hp = this->bandHashParams[tableIdx * BANDS + bandIdx];
+            const uint32_t *rows = sig.data() + bandIdx * ROWS;
+            size_t hash = 0;
 
-    auto it = signatures.find(userId);
-    if (it == signatures.end())
+            for (int i = 0; i < ROWS; i++)
+            {
+                uint64_t temp = (uint64_t)hp.a * rows[i] + hp.b;
+                hash = (hash * 37 + (temp % 20000)) % Config::LARGE_PRIME;
+            }
+
+            return hash % 20000;
+        }
+    };
+
+    template <int HASHES, int BANDS, int ROWS>
+    void BandedIndex<HASHES, BANDS, ROWS>::indexSignatures()
     {
-        return {};
+        this->packSignatures();
+        if (!this->signatures)
+        {
+            this->bucketOffsets.clear();
+            this->bucketUsers.clear();
+            return;
+        }
+        const size_t numUsers = this->numSignatures();
+        const vector<Signature> &sigs = *this->signatures;
+        const int numTables = this->params.numTables;
+
+        vector<uint32_t> userBuckets(numUsers * numTables);
+        ThreadPool::instance().parallelFor(0, numUsers, 1024, [&](size_t startIdx, size_t endIdx)
+                                           {
+            for (size_t u = startIdx; u < endIdx; u++) {
+                for (int tableIdx = 0; tableIdx < numTables; tableIdx++) {
+                    userBuckets[u * numTables + tableIdx] = tableHash(sigs[u], tableIdx);
+                }
+            } });
+
+        this->buildBuckets(userBuckets, numUsers);
     }
 
-    const MinHashSignature &querySignature = it->second;
-    unordered_map<uint32_t, int> candidateCount;
+    template <int HASHES, int BANDS, int ROWS>
+    vector<uint32_t> BandedIndex<HASHES, BANDS, ROWS>::findSimilarCandidates(uint32_t userId, int maxCandidates) const
+    {
+        if (userId >= this->numSignatures() || this->bucketOffsets.empty())
+        {
+            return {};
+        }
 
-    const int BANDS_PER_TABLE = 3;
+        const LSHIndex::Params &params = this->params;
+        const vector<Signature> &sigs = *this->signatures;
+        const Signature &querySignature = sigs[userId];
 
-    for (int tableIdx = 0; tableIdx < Config::NUM_TABLES; tableIdx++)
-    {
-        int startBand = (tableIdx * BANDS_PER_TABLE) % Config::NUM_BANDS;
-        size_t combinedHash = 0;
-        for (int i = 0; i < BANDS_PER_TABLE; i++)
+        thread_local LSHIndex::CandidateCounter candidateCount;
+        candidateCount.reset(sigs.size());
+
+        for (int tableIdx = 0; tableIdx < params.numTables; tableIdx++)
         {
-            int bandIdx = (startBand + i) % Config::NUM_BANDS;
-            size_t bandHash = hashBand(querySignature, bandIdx, tableIdx);
-            combinedHash = (combinedHash << 16) ^ bandHash;
+            candidateCount.add(this->bucket(tableIdx, tableHash(querySignature, tableIdx)), userId);
         }
 
-        size_t finalHash = combinedHash % 4000;
-        auto bucketIt = tables[tableIdx].find(finalHash);
-        if (bucketIt != tables[tableIdx].end())
+        if (candidateCount.touched.size() < 50)
         {
-            for (uint32_t candidateId : bucketIt->second)
+            for (int tableIdx = 0; tableIdx < min(3, params.numTables); tableIdx++)
             {
-                if (candidateId != userId)
+                for (int probe = 1; probe <= 2; probe++)
                 {
-                    candidateCount[candidateId]++;
+                    int startBand = (tableIdx * params.bandsPerTable) % BANDS;
+                    size_t combinedHash = 0;
+
+                    for (int i = 0; i < params.bandsPerTable; i++)
+                    {
+                        int bandIdx = (startBand + i) % BANDS;
+                        size_t bandHash = hashBand(querySignature, bandIdx, tableIdx);
+                        bandHash = (bandHash + probe) % Config::LARGE_PRIME;
+                        combinedHash = (combinedHash << 16) ^ bandHash;
+                    }
+
+                    candidateCount.add(this->bucket(tableIdx, combinedHash % params.numBuckets), userId);
                 }
             }
         }
-    }
 
-    if (candidateCount.size() < 50)
-    {
-        for (int tableIdx = 0; tableIdx < min(3, Config::NUM_TABLES); tableIdx++)
-        {
-            for (int probe = 1; probe <= 2; probe++)
+        vector<pair<int, uint32_t>> scoredCandidates;
+        scoredCandidates.reserve(candidateCount.touched.size());
+
+        this->withSignatureBits([&](auto bits)
+                                {
+            for (uint32_t candidateId : candidateCount.touched)
             {
-                int startBand = (tableIdx * BANDS_PER_TABLE) % Config::NUM_BANDS;
-                size_t combinedHash = 0;
+                const int count = candidateCount.counts[candidateId];
+                float similarity = this->template similarity<decltype(bits)::value>(userId, candidateId);
+                float score = count * 0.3f + similarity * 0.7f;
+                scoredCandidates.push_back({(int)(score * 1000), candidateId});
+            } });
 
-                for (int i = 0; i < BANDS_PER_TABLE; i++)
-                {
-                    int bandIdx = (startBand + i) % Config::NUM_BANDS;
-                    size_t bandHash = hashBand(querySignature, bandIdx, tableIdx);
-                    bandHash = (bandHash + probe) % Config::LARGE_PRIME;
-                    combinedHash = (combinedHash << 16) ^ bandHash;
-                }
+        sort(scoredCandidates.begin(), scoredCandidates.end(), greater<pair<int, uint32_t>>());
 
-                size_t finalHash = combinedHash % 4000;
-                auto bucketIt = tables[tableIdx].find(finalHash);
+        vector<uint32_t> candidates;
+        candidates.reserve(min((int)scoredCandidates.size(), maxCandidates));
 
-                if (bucketIt != tables[tableIdx].end())
-                {
-                    for (uint32_t candidateId : bucketIt->second)
-                    {
-                        if (candidateId != userId)
-                        {
-                            candidateCount[candidateId]++;
-                        }
-                    }
-                }
-            }
+        for (int i = 0; i < min((int)scoredCandidates.size(), maxCandidates); i++)
+        {
+            candidates.push_back(scoredCandidates[i].second);
         }
+
+        return candidates;
     }
 
-    vector<pair<int, uint32_t>> scoredCandidates;
-    scoredCandidates.reserve(candidateCount.size());
+    struct Preset
+    {
+        int numHashes, numBands, rowsPerBand;
+        unique_ptr<LSHIndex> (*make)(const LSHIndex::Params &);
+    };
 
-    for (const auto &[candidateId, count] : candidateCount)
+    template <int HASHES, int BANDS, int ROWS>
+    unique_ptr<LSHIndex> makeIndex(const LSHIndex::Params &params)
     {
-        float similarity = estimateJaccardSimilarity(userId, candidateId);
-        float score = count * 0.3f + similarity * 0.7f;
-        scoredCandidates.push_back({(int)(score * 1000), candidateId});
+        return make_unique<BandedIndex<HASHES, BANDS, ROWS>>(params);
     }
 
-    sort(scoredCandidates.begin(), scoredCandidates.end(), greater<pair<int, uint32_t>>());
+    // O formato de Config primeiro; os demais são os que --tune percorre.
+    const Preset PRESETS[] = {
+        {Config::NUM_HASH_FUNCTIONS, Config::NUM_BANDS, Config::ROWS_PER_BAND,
+         makeIndex<Config::NUM_HASH_FUNCTIONS, Config::NUM_BANDS, Config::ROWS_PER_BAND>},
+        {96, 48, 2, makeIndex<96, 48, 2>},
+        {96, 32, 3, makeIndex<96, 32, 3>},
+        {96, 24, 4, makeIndex<96, 24, 4>},
+        {96, 16, 6, makeIndex<96, 16, 6>},
+        {96, 12, 8, makeIndex<96, 12, 8>},
+        {64, 32, 2, makeIndex<64, 32, 2>},
+        {64, 16, 4, makeIndex<64, 16, 4>},
+        {128, 64, 2, makeIndex<128, 64, 2>},
+        {128, 32, 4, makeIndex<128, 32, 4>},
+    };
+}
 
-    vector<uint32_t> candidates;
-    candidates.reserve(min((int)scoredCandidates.size(), maxCandidates));
+bool LSHIndex::Params::valid() const
+{
+    return (signatureBits == 0 || signatureBits == 1 || signatureBits == 2 || signatureBits == 4) &&
+           numHashes > 0 && numBands > 0 && rowsPerBand > 0 && numBands * rowsPerBand <= numHashes &&
+           numTables > 0 && bandsPerTable > 0 && bandsPerTable <= numBands && numBuckets > 0;
+}
 
-    for (int i = 0; i < min((int)scoredCandidates.size(), maxCandidates); i++)
+vector<LSHIndex::Params> LSHIndex::presets()
+{
+    vector<Params> shapes;
+    for (const Preset &preset : PRESETS)
     {
-        candidates.push_back(scoredCandidates[i].second);
+        Params params;
+        params.numHashes = preset.numHashes;
+        params.numBands = preset.numBands;
+        params.rowsPerBand = preset.rowsPerBand;
+        const bool seen = any_of(shapes.begin(), shapes.end(), [&](const Params &other)
+                                 { return other.numHashes == params.numHashes && other.numBands == params.numBands &&
+                                          other.rowsPerBand == params.rowsPerBand; });
+        if (!seen)
+            shapes.push_back(params);
     }
+    return shapes;
+}
 
-    return candidates;
+unique_ptr<LSHIndex> LSHIndex::create(const Params &params)
+{
+    if (!params.valid())
+    {
+        return nullptr;
+    }
+    for (const Preset &preset : PRESETS)
+    {
+        if (preset.numHashes == params.numHashes && preset.numBands == params.numBands &&
+            preset.rowsPerBand == params.rowsPerBand)
+        {
+            return preset.make(params);
+        }
+    }
+    return nullptr;
 }
 
-float LSHIndex::estimateJaccardSimilarity(uint32_t user1, uint32_t user2) const
+LSHIndex::LSHIndex(const Params &p) : params(p), rng(p.seed ? p.seed : std::random_device{}())
 {
-    auto it1 = signatures.find(user1);
-    auto it2 = signatures.find(user2);
+    bandHashParams.resize(static_cast<size_t>(params.numTables) * params.numBands);
+    for (int t = 0; t < params.numTables; t++)
+    {
+        for (int b = 0; b < params.numBands; b++)
+        {
+            uniform_int_distribution<uint32_t> dist(1, Config::LARGE_PRIME - 1);
+            bandHashParams[t * params.numBands + b].a = dist(rng);
+            bandHashParams[t * params.numBands + b].b = dist(rng);
+        }
+    }
+}
 
-    if (it1 == signatures.end() || it2 == signatures.end())
+void LSHIndex::buildBuckets(const vector<uint32_t> &userBuckets, size_t numUsers)
+{
+    bucketOffsets.assign(params.numTables * (params.numBuckets + 1), 0);
+    for (size_t u = 0; u < numUsers; u++)
     {
-        return 0.0f;
+        for (int tableIdx = 0; tableIdx < params.numTables; tableIdx++)
+        {
+            bucketOffsets[tableIdx * (params.numBuckets + 1) + userBuckets[u * params.numTables + tableIdx] + 1]++;
+        }
     }
 
-    const auto &sig1 = it1->second.signature;
-    const auto &sig2 = it2->second.signature;
+    uint32_t total = 0;
+    for (int tableIdx = 0; tableIdx < params.numTables; tableIdx++)
+    {
+        uint32_t *offsets = &bucketOffsets[tableIdx * (params.numBuckets + 1)];
+        offsets[0] = total;
+        for (size_t b = 1; b <= params.numBuckets; b++)
+        {
+            offsets[b] += offsets[b - 1];
+        }
+        total = offsets[params.numBuckets];
+    }
 
-    int matches = 0;
-    for (int i = 0; i < Config::NUM_HASH_FUNCTIONS; i++)
+    bucketUsers.assign(total, 0);
+    vector<uint32_t> cursor(bucketOffsets);
+    for (size_t u = 0; u < numUsers; u++)
     {
-        if (sig1[i] == sig2[i])
+        for (int tableIdx = 0; tableIdx < params.numTables; tableIdx++)
         {
-            matches++;
+            const size_t slot = tableIdx * (params.numBuckets + 1) + userBuckets[u * params.numTables + tableIdx];
+            bucketUsers[cursor[slot]++] = static_cast<uint32_t>(u);
         }
     }
+}
 
-    return (float)matches / Config::NUM_HASH_FUNCTIONS;
+LSHIndex::Bucket LSHIndex::bucket(int tableIdx, size_t bucketHash) const
+{
+    const uint32_t *offsets = &bucketOffsets[tableIdx * (params.numBuckets + 1)];
+    return {bucketUsers.data() + offsets[bucketHash], offsets[bucketHash + 1] - offsets[bucketHash]};
 }
 
-size_t LSHIndex::hashBand(const MinHashSignature &sig, int bandIdx, int tableIdx) const
+void LSHIndex::CandidateCounter::reset(size_t numUsers)
 {
-    size_t hash = 0;
-    int startIdx = bandIdx * Config::ROWS_PER_BAND;
+    if (stamps.size() < numUsers)
+    {
+        stamps.assign(numUsers, 0);
+        counts.assign(numUsers, 0);
+        generation = 0;
+    }
 
-    for (int i = 0; i < Config::ROWS_PER_BAND; i++)
+    touched.clear();
+    if (++generation == 0)
     {
-        uint32_t val = sig.signature[startIdx + i];
-        uint64_t temp = (uint64_t)bandHashParams[tableIdx][bandIdx].a * val +
-                        bandHashParams[tableIdx][bandIdx].b;
-        hash = (hash * 37 + (temp % 20000)) % Config::LARGE_PRIME;
+        fill(stamps.begin(), stamps.end(), 0);
+        generation = 1;
     }
+}
 
-    return hash % 20000;
+void LSHIndex::CandidateCounter::add(const Bucket &bucket, uint32_t self)
+{
+    for (size_t i = 0; i < bucket.size; i++)
+    {
+        const uint32_t candidateId = bucket.users[i];
+        if (candidateId == self)
+            continue;
+        if (stamps[candidateId] != generation)
+        {
+            stamps[candidateId] = generation;
+            counts[candidateId] = 0;
+            touched.push_back(candidateId);
+        }
+        counts[candidateId]++;
+    }
 }
 
-vector<pair<uint32_t, uint32_t>> LSHIndex::generateHashFunctions()
+// Família multiply-shift: h(x) = (a * x + b) >> 32 com a ímpar de 64 bits. Evita o módulo
+// por primo e vetoriza bem na construção da matriz de hashes.
+vector<pair<uint64_t, uint64_t>> LSHIndex::generateHashFunctions(int count)
 {
-    vector<pair<uint32_t, uint32_t>> functions;
-    uniform_int_distribution<uint32_t> dist(1, Config::LARGE_PRIME - 1);
+    vector<pair<uint64_t, uint64_t>> functions;
+    uniform_int_distribution<uint64_t> dist;
 
-    for (int i = 0; i < Config::NUM_HASH_FUNCTIONS; i++)
+    for (int i = 0; i < count; i++)
     {
-        functions.push_back({dist(rng), dist(rng)});
+        const uint64_t a = dist(rng) | 1;
+        functions.push_back({a, dist(rng)});
     }
 
     return functions;
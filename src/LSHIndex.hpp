@@ -2,63 +2,108 @@
 #define LSH_INDEX_HPP
 
 #include "Config.hpp"
-#include "DataStructures.hpp"
+#include "RatingStore.hpp"
 
 
-struct MinHashSignature
-{
-    std::vector<uint32_t> signature;
-    uint32_t userId;
-
-    MinHashSignature() : signature(Config::NUM_HASH_FUNCTIONS), userId(0) {}
-    MinHashSignature(uint32_t id) : signature(Config::NUM_HASH_FUNCTIONS), userId(id) {}
-};
+// Assinatura MinHash de um usuário, indexada pelo índice denso dele na matriz de assinaturas.
+template <int HASHES>
+using MinHashSignature = std::array<uint32_t, HASHES>;
 
+// Interface do índice LSH. As implementações são especializadas em tempo de compilação no formato
+// (hashes, bandas, linhas por banda) e escolhidas em presets(); tabelas, bandas por tabela e buckets
+// continuam em tempo de execução.
 class LSHIndex
 {
-private:
-    std::vector<std::unordered_map<size_t, std::vector<uint32_t>>> tables;
-
-    std::unordered_map<uint32_t, MinHashSignature> signatures;
-
-    struct HashParams
+public:
+    // Parâmetros do banding. numBands * rowsPerBand não pode passar de numHashes; bandsPerTable
+    // bandas consecutivas formam a chave de cada tabela.
+    struct Params
     {
-        uint32_t a, b;
+        int numHashes = Config::NUM_HASH_FUNCTIONS;
+        int numBands = Config::NUM_BANDS;
+        int rowsPerBand = Config::ROWS_PER_BAND;
+        int numTables = Config::NUM_TABLES;
+        int bandsPerTable = Config::LSH_BANDS_PER_TABLE;
+        size_t numBuckets = Config::LSH_NUM_BUCKETS;
+        int signatureBits = Config::LSH_SIGNATURE_BITS; // 0: reordena os candidatos pelas assinaturas de 32 bits
+        uint32_t seed = Config::LSH_SEED;                // 0: std::random_device
+
+        bool valid() const;
     };
-    std::vector<std::vector<HashParams>> bandHashParams; 
 
-    mutable std::mutex indexMutex;
+    // Formatos compilados (numHashes, numBands, rowsPerBand; o resto com os valores de Config).
+    static std::vector<Params> presets();
 
-    std::mt19937 rng;
+    // nullptr se os parâmetros são inválidos ou o formato não está entre os presets.
+    static std::unique_ptr<LSHIndex> create(const Params &params);
 
-public:
-    LSHIndex();
+    virtual ~LSHIndex() = default;
+
+    const Params &parameters() const { return params; }
+
+    virtual void buildSignatures(const RatingStore &store) = 0;
 
-    void buildSignatures(
-        const std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, float>>> &userRatings,
-        int numThreads = 8);
+    // Reaproveita as assinaturas de other (que só dependem das funções de MinHash); falha se o
+    // número de hashes for diferente.
+    virtual bool shareSignatures(const LSHIndex &other) = 0;
 
-    void indexSignatures();
+    virtual void indexSignatures() = 0;
 
-    std::vector<uint32_t> findSimilarCandidates(
+    virtual std::vector<uint32_t> findSimilarCandidates(
         uint32_t userId,
-        int maxCandidates = 500) const;
+        int maxCandidates = 500) const = 0;
+
+    virtual float estimateJaccardSimilarity(uint32_t user1, uint32_t user2) const = 0;
+
+    // Soma do tamanho dos buckets do usuário em todas as tabelas (estimativa do custo da consulta).
+    virtual size_t bucketOccupancy(uint32_t userId) const = 0;
+
+    // Bucket do usuário na primeira tabela (numBuckets se o índice não foi construído);
+    // usuários com a mesma chave compartilham boa parte dos candidatos.
+    virtual size_t primaryBucket(uint32_t userId) const = 0;
 
-    float estimateJaccardSimilarity(uint32_t user1, uint32_t user2) const;
+protected:
+    explicit LSHIndex(const Params &params);
 
+    Params params;
 
-private:
+    // Buckets congelados em CSR: bucketOffsets[t * (numBuckets + 1) + b] indexa bucketUsers.
+    // Somente leitura depois de indexSignatures, então as consultas não usam lock.
+    std::vector<uint32_t> bucketOffsets;
+    std::vector<uint32_t> bucketUsers;
+
+    struct Bucket
+    {
+        const uint32_t *users;
+        size_t size;
+    };
+
+    // Contador denso por thread; stamps != generation equivale a contagem zero.
+    struct CandidateCounter
+    {
+        std::vector<uint32_t> stamps;
+        std::vector<int> counts;
+        std::vector<uint32_t> touched;
+        uint32_t generation = 0;
+
+        void reset(size_t numUsers);
+        void add(const Bucket &bucket, uint32_t self);
+    };
+
+    struct HashParams
+    {
+        uint32_t a, b;
+    };
+    std::vector<HashParams> bandHashParams; // [tableIdx * numBands + bandIdx]
+
+    std::mt19937 rng;
 
-    MinHashSignature computeMinHash(
-        const std::vector<uint32_t> &movies,
-        uint32_t userId);
+    Bucket bucket(int tableIdx, size_t bucketHash) const;
 
-    size_t hashBand(
-        const MinHashSignature &sig,
-        int bandIdx,
-        int tableIdx) const;
+    // userBuckets[u * numTables + t] é o bucket do usuário u na tabela t.
+    void buildBuckets(const std::vector<uint32_t> &userBuckets, size_t numUsers);
 
-    std::vector<std::pair<uint32_t, uint32_t>> generateHashFunctions();
+    std::vector<std::pair<uint64_t, uint64_t>> generateHashFunctions(int count);
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -1,28 +1,54 @@
 #include "Config.hpp"
 
+#include "Benchmark.hpp"
 #include "FastRecommendationSystem.hpp"
+#include "ModelSnapshot.hpp"
+#include "Options.hpp"
 #include "preProcessament.hpp"
 
 using namespace std;
 
 int main(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
-
     try
     {
-        if (process_ratings_file() != 0)
-        { 
-            return 1; 
+        const RunOptions options = parseRunOptions(argc, argv);
+        Benchmark benchmark;
+        vector<RatingBatch> preprocessed;
+
+        {
+            Benchmark::StageTimer timer(benchmark, "preprocess");
+            // Com o snapshot em dia as notas vêm dele; --write-input ainda grava o input.dat.
+            const bool fresh = ModelSnapshot::isFresh(Config::SNAPSHOT_FILE);
+            if ((!fresh || options.writeInputFile) &&
+                process_ratings_file(fresh ? nullptr : &preprocessed, options.writeInputFile) != 0)
+            {
+                return 1;
+            }
+        }
+
+        FastRecommendationSystem system(options, benchmark);
+        system.loadData(move(preprocessed));
+        if (options.evaluate || options.tune)
+        {
+            if (!system.evaluate(Config::USERS_FILE))
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            system.processRecommendations(Config::USERS_FILE);
         }
 
-        FastRecommendationSystem system;
-        system.loadData();
-        system.processRecommendations(Config::USERS_FILE);
+        if (options.bench && !benchmark.writeJson(Config::BENCH_FILE))
+        {
+            return 1;
+        }
     }
     catch (const exception &e)
     {
+        cerr << "erro: " << e.what() << endl;
         return 1;
     }
 
@@ -0,0 +1,296 @@
+#include "ModelSnapshot.hpp"
+#include "preProcessament.hpp"
+
+using namespace std;
+
+namespace
+{
+    const char SNAPSHOT_MAGIC[8] = {'M', 'R', 'S', 'N', 'A', 'P', '\0', '\0'};
+    const uint32_t SNAPSHOT_VERSION = 4;
+    const size_t SECTION_ALIGNMENT = 64;
+
+    enum Section
+    {
+        USER_IDS,
+        USER_OFFSETS,
+        USER_BYTE_OFFSETS,
+        USER_AVG,
+        USER_NORM,
+        USER_CENTERED_NORM,
+        USER_MOVIES,
+        USER_RATINGS,
+        MOVIE_IDS,
+        MOVIE_OFFSETS,
+        MOVIE_BYTE_OFFSETS,
+        MOVIE_AVG,
+        MOVIE_POPULARITY,
+        MOVIE_USERS,
+        MOVIE_RATINGS,
+        SECTION_COUNT
+    };
+
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t fileSize;
+        uint64_t sourceSize;
+        int64_t sourceMtimeNs;
+        uint64_t numUsers;
+        uint64_t numMovies;
+        uint64_t numRatings;
+        uint64_t userMovieBytes;  // fluxos delta-varint, já com o padding
+        uint64_t movieUserBytes;
+        float globalAvgRating;
+        uint32_t reserved;
+        uint64_t sectionOffset[SECTION_COUNT];
+    };
+
+    size_t alignUp(size_t value)
+    {
+        return (value + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+
+    bool validHeader(const SnapshotHeader &header, uint64_t fileSize)
+    {
+        return memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+               header.version == SNAPSHOT_VERSION &&
+               header.headerSize == sizeof(SnapshotHeader) &&
+               header.fileSize == fileSize;
+    }
+
+    // Falha se a seção não couber no arquivo (cabeçalho danificado ou editado).
+    template <typename T>
+    bool readSection(const char *base, const SnapshotHeader &header, Section s,
+                     size_t count, std::vector<T> &out)
+    {
+        const uint64_t offset = header.sectionOffset[s];
+        if (offset > header.fileSize || count > (header.fileSize - offset) / sizeof(T))
+            return false;
+
+        const T *begin = reinterpret_cast<const T *>(base + offset);
+        out.assign(begin, begin + count);
+        return true;
+    }
+
+    // Tabela de offsets de 0 até last, sem decrescer.
+    bool validOffsets(const vector<uint64_t> &offsets, uint64_t last)
+    {
+        return !offsets.empty() && offsets.front() == 0 && offsets.back() == last &&
+               is_sorted(offsets.begin(), offsets.end());
+    }
+}
+
+bool ModelSnapshot::currentSource(SnapshotSource &source)
+{
+    const char *ratingsFile = find_ratings_file();
+    if (!ratingsFile)
+    {
+        return false;
+    }
+
+    struct stat sb;
+    if (stat(ratingsFile, &sb) == -1)
+    {
+        return false;
+    }
+
+    source.size = static_cast<uint64_t>(sb.st_size);
+    source.mtimeNs = static_cast<int64_t>(sb.st_mtim.tv_sec) * 1000000000LL + sb.st_mtim.tv_nsec;
+    return true;
+}
+
+bool ModelSnapshot::isFresh(const string &filename)
+{
+    SnapshotSource source;
+    if (!currentSource(source))
+    {
+        return false;
+    }
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    struct stat sb;
+    SnapshotHeader header;
+    const bool ok = fstat(fd, &sb) == 0 &&
+                    pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                    validHeader(header, static_cast<uint64_t>(sb.st_size)) &&
+                    header.sourceSize == source.size &&
+                    header.sourceMtimeNs == source.mtimeNs;
+    close(fd);
+    return ok;
+}
+
+bool ModelSnapshot::load(const string &filename, RatingStore &store)
+{
+    if (!isFresh(filename))
+    {
+        return false;
+    }
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) == -1 || static_cast<size_t>(sb.st_size) < sizeof(SnapshotHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    const char *const data = static_cast<const char *>(
+        mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0));
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const SnapshotHeader &header = *reinterpret_cast<const SnapshotHeader *>(data);
+    if (!validHeader(header, static_cast<uint64_t>(sb.st_size)))
+    {
+        munmap(const_cast<char *>(data), sb.st_size);
+        return false;
+    }
+
+    const size_t numUsers = header.numUsers;
+    const size_t numMovies = header.numMovies;
+    const size_t numRatings = header.numRatings;
+
+    store = RatingStore();
+    const bool ok =
+        readSection(data, header, USER_IDS, numUsers, store.userIds) &&
+        readSection(data, header, USER_OFFSETS, numUsers + 1, store.userLists.offsets) &&
+        readSection(data, header, USER_BYTE_OFFSETS, numUsers + 1, store.userLists.byteOffsets) &&
+        readSection(data, header, USER_AVG, numUsers, store.userAvgRating) &&
+        readSection(data, header, USER_NORM, numUsers, store.userNorm) &&
+        readSection(data, header, USER_CENTERED_NORM, numUsers, store.userCenteredNorm) &&
+        readSection(data, header, USER_MOVIES, header.userMovieBytes, store.userLists.ids) &&
+        readSection(data, header, USER_RATINGS, numRatings, store.userLists.codes) &&
+        readSection(data, header, MOVIE_IDS, numMovies, store.movieIds) &&
+        readSection(data, header, MOVIE_OFFSETS, numMovies + 1, store.movieLists.offsets) &&
+        readSection(data, header, MOVIE_BYTE_OFFSETS, numMovies + 1, store.movieLists.byteOffsets) &&
+        readSection(data, header, MOVIE_AVG, numMovies, store.movieAvgRating) &&
+        readSection(data, header, MOVIE_POPULARITY, numMovies, store.moviePopularity) &&
+        readSection(data, header, MOVIE_USERS, header.movieUserBytes, store.movieLists.ids) &&
+        readSection(data, header, MOVIE_RATINGS, numRatings, store.movieLists.codes) &&
+        validOffsets(store.userLists.offsets, numRatings) &&
+        header.userMovieBytes >= ProfileCodec::PADDING && header.movieUserBytes >= ProfileCodec::PADDING &&
+        validOffsets(store.userLists.byteOffsets, header.userMovieBytes - ProfileCodec::PADDING) &&
+        validOffsets(store.movieLists.offsets, numRatings) &&
+        validOffsets(store.movieLists.byteOffsets, header.movieUserBytes - ProfileCodec::PADDING);
+    store.globalAvgRating = header.globalAvgRating;
+
+    munmap(const_cast<char *>(data), sb.st_size);
+    if (!ok)
+    {
+        store = RatingStore();
+        return false;
+    }
+
+    store.userPreferredGenres.assign(numUsers, 0);
+    store.movieGenres.assign(numMovies, 0);
+    store.buildIdIndex();
+    store.buildPopularityRanking();
+    return true;
+}
+
+bool ModelSnapshot::save(const string &filename, const RatingStore &store)
+{
+    SnapshotSource source;
+    if (!currentSource(source) || !store.hasTranspose())
+    {
+        return false;
+    }
+
+    const uint64_t numUsers = store.numUsers();
+    const uint64_t numMovies = store.numMovies();
+    const uint64_t numRatings = store.numRatings();
+
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.sourceSize = source.size;
+    header.sourceMtimeNs = source.mtimeNs;
+    header.numUsers = numUsers;
+    header.numMovies = numMovies;
+    header.numRatings = numRatings;
+    header.userMovieBytes = store.userLists.ids.size();
+    header.movieUserBytes = store.movieLists.ids.size();
+    header.globalAvgRating = store.globalAvgRating;
+
+    const pair<const void *, size_t> sections[SECTION_COUNT] = {
+        {store.userIds.data(), numUsers * sizeof(uint32_t)},
+        {store.userLists.offsets.data(), (numUsers + 1) * sizeof(uint64_t)},
+        {store.userLists.byteOffsets.data(), (numUsers + 1) * sizeof(uint64_t)},
+        {store.userAvgRating.data(), numUsers * sizeof(float)},
+        {store.userNorm.data(), numUsers * sizeof(float)},
+        {store.userCenteredNorm.data(), numUsers * sizeof(float)},
+        {store.userLists.ids.data(), header.userMovieBytes},
+        {store.userLists.codes.data(), numRatings},
+        {store.movieIds.data(), numMovies * sizeof(uint32_t)},
+        {store.movieLists.offsets.data(), (numMovies + 1) * sizeof(uint64_t)},
+        {store.movieLists.byteOffsets.data(), (numMovies + 1) * sizeof(uint64_t)},
+        {store.movieAvgRating.data(), numMovies * sizeof(float)},
+        {store.moviePopularity.data(), numMovies * sizeof(int32_t)},
+        {store.movieLists.ids.data(), header.movieUserBytes},
+        {store.movieLists.codes.data(), numRatings},
+    };
+
+    size_t offset = alignUp(sizeof(SnapshotHeader));
+    for (int s = 0; s < SECTION_COUNT; ++s)
+    {
+        header.sectionOffset[s] = offset;
+        offset = alignUp(offset + sections[s].second);
+    }
+    header.fileSize = offset;
+
+    const string tempFilename = filename + ".tmp";
+    FILE *out = fopen(tempFilename.c_str(), "wb");
+    if (!out)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    size_t written = 0;
+    auto writeBytes = [&](const void *bytes, size_t len)
+    {
+        ok = ok && fwrite(bytes, 1, len, out) == len;
+        written += len;
+    };
+    auto padTo = [&](size_t target)
+    {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        while (ok && written < target)
+        {
+            writeBytes(zeros, min(target - written, SECTION_ALIGNMENT));
+        }
+    };
+
+    writeBytes(&header, sizeof(header));
+    for (int s = 0; s < SECTION_COUNT; ++s)
+    {
+        padTo(header.sectionOffset[s]);
+        writeBytes(sections[s].first, sections[s].second);
+    }
+    padTo(header.fileSize);
+
+    ok = (fclose(out) == 0) && ok;
+    if (!ok || rename(tempFilename.c_str(), filename.c_str()) != 0)
+    {
+        remove(tempFilename.c_str());
+        return false;
+    }
+
+    return true;
+}
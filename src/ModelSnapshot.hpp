@@ -0,0 +1,26 @@
+#ifndef MODEL_SNAPSHOT_HPP
+#define MODEL_SNAPSHOT_HPP
+
+#include "Config.hpp"
+#include "RatingStore.hpp"
+
+struct SnapshotSource
+{
+    uint64_t size = 0;
+    int64_t mtimeNs = 0;
+};
+
+class ModelSnapshot
+{
+public:
+    static bool isFresh(const std::string &filename);
+
+    static bool load(const std::string &filename, RatingStore &store);
+
+    static bool save(const std::string &filename, const RatingStore &store);
+
+    // Tamanho e mtime do ratings.csv, usados para invalidar os arquivos derivados dele.
+    static bool currentSource(SnapshotSource &source);
+};
+
+#endif
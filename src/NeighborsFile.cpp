@@ -0,0 +1,55 @@
+#include "NeighborsFile.hpp"
+
+using namespace std;
+
+bool NeighborsFile::validOffsets(const vector<uint64_t> &offsets, uint64_t numEntries)
+{
+    return !offsets.empty() && offsets.front() == 0 && offsets.back() == numEntries &&
+           is_sorted(offsets.begin(), offsets.end());
+}
+
+bool NeighborsFile::read(const string &filename, void *header, size_t headerSize, const function<bool(Reader &)> &body)
+{
+    FILE *in = fopen(filename.c_str(), "rb");
+    if (!in)
+    {
+        return false;
+    }
+
+    struct stat sb;
+    if (fstat(fileno(in), &sb) == -1 || static_cast<uint64_t>(sb.st_size) < headerSize)
+    {
+        fclose(in);
+        return false;
+    }
+
+    Reader reader(in, static_cast<uint64_t>(sb.st_size) - headerSize);
+    const bool ok = fread(header, headerSize, 1, in) == 1 &&
+                    body(reader) &&
+                    fgetc(in) == EOF;
+    fclose(in);
+    return ok;
+}
+
+bool NeighborsFile::write(const string &filename, const void *header, size_t headerSize, const function<bool(Writer &)> &body)
+{
+    const string tempFilename = filename + ".tmp";
+    FILE *out = fopen(tempFilename.c_str(), "wb");
+    if (!out)
+    {
+        return false;
+    }
+
+    Writer writer(out);
+    bool ok = fwrite(header, headerSize, 1, out) == 1 &&
+              body(writer);
+
+    ok = (fclose(out) == 0) && ok;
+    if (!ok || rename(tempFilename.c_str(), filename.c_str()) != 0)
+    {
+        remove(tempFilename.c_str());
+        return false;
+    }
+
+    return true;
+}
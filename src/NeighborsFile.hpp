@@ -0,0 +1,127 @@
+#ifndef NEIGHBORS_FILE_HPP
+#define NEIGHBORS_FILE_HPP
+
+#include "Config.hpp"
+#include "ModelSnapshot.hpp"
+
+#include <functional>
+
+// Formato das tabelas de vizinhos persistidas (ItemNeighbors, UserNeighbors): um cabeçalho com a
+// origem (ratings.csv), o número de entradas e os parâmetros da tabela, seguido dos arrays dela.
+// O arquivo só é aceito se o cabeçalho bater byte a byte com o da execução atual e terminar logo
+// depois dos arrays; a gravação vai para um .tmp renomeado no fim.
+namespace NeighborsFile
+{
+    // Params: struct trivial com os tamanhos do modelo e os parâmetros da construção.
+    template <typename Params>
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t sourceSize;
+        int64_t sourceMtimeNs;
+        uint64_t numEntries;
+        Params params;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(FILE *f, uint64_t bytes) : file(f), remaining(bytes) {}
+
+        // Se ainda cabem count elementos no arquivo: contagens vindas do cabeçalho passam por aqui
+        // antes de dimensionar os arrays.
+        template <typename T>
+        bool fits(uint64_t count) const { return count <= remaining / sizeof(T); }
+
+        // Preenche values inteiro (já dimensionado).
+        template <typename T>
+        bool read(std::vector<T> &values)
+        {
+            if (!fits<T>(values.size()) || fread(values.data(), sizeof(T), values.size(), file) != values.size())
+                return false;
+            remaining -= values.size() * sizeof(T);
+            return true;
+        }
+
+    private:
+        FILE *file;
+        uint64_t remaining;
+    };
+
+    class Writer
+    {
+    public:
+        explicit Writer(FILE *f) : file(f) {}
+
+        template <typename T>
+        bool write(const std::vector<T> &values)
+        {
+            return fwrite(values.data(), sizeof(T), values.size(), file) == values.size();
+        }
+
+    private:
+        FILE *file;
+    };
+
+    // Offsets de CSR: começam em 0, não decrescem e terminam em numEntries.
+    bool validOffsets(const std::vector<uint64_t> &offsets, uint64_t numEntries);
+
+    // Lê headerSize bytes em header e chama body, que confere o cabeçalho e lê os arrays.
+    bool read(const std::string &filename, void *header, size_t headerSize, const std::function<bool(Reader &)> &body);
+
+    bool write(const std::string &filename, const void *header, size_t headerSize, const std::function<bool(Writer &)> &body);
+
+    template <typename Params>
+    Header<Params> makeHeader(const char (&magic)[8], uint32_t version, const SnapshotSource &source,
+                              uint64_t numEntries, const Params &params)
+    {
+        // Zerado inteiro: o preenchimento também entra na comparação com memcmp.
+        Header<Params> header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic, sizeof(header.magic));
+        header.version = version;
+        header.headerSize = sizeof(Header<Params>);
+        header.sourceSize = source.size;
+        header.sourceMtimeNs = source.mtimeNs;
+        header.numEntries = numEntries;
+        header.params = params;
+        return header;
+    }
+
+    // readArrays(reader, numEntries) dimensiona e lê os arrays da tabela; só é chamado com o
+    // cabeçalho válido, mas numEntries vem do arquivo e precisa passar por Reader::fits.
+    template <typename Params, typename ReadArrays>
+    bool load(const std::string &filename, const char (&magic)[8], uint32_t version, const Params &params,
+              ReadArrays readArrays)
+    {
+        SnapshotSource source;
+        if (!ModelSnapshot::currentSource(source))
+        {
+            return false;
+        }
+
+        Header<Params> header;
+        return read(filename, &header, sizeof(header), [&](Reader &in)
+                    {
+            const Header<Params> expected = makeHeader(magic, version, source, header.numEntries, params);
+            return memcmp(&header, &expected, sizeof(header)) == 0 && readArrays(in, header.numEntries); });
+    }
+
+    template <typename Params>
+    bool save(const std::string &filename, const char (&magic)[8], uint32_t version, const Params &params,
+              uint64_t numEntries, const std::function<bool(Writer &)> &writeArrays)
+    {
+        SnapshotSource source;
+        if (!ModelSnapshot::currentSource(source))
+        {
+            return false;
+        }
+
+        const Header<Params> header = makeHeader(magic, version, source, numEntries, params);
+        return write(filename, &header, sizeof(header), writeArrays);
+    }
+}
+
+#endif
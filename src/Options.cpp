@@ -0,0 +1,112 @@
+#include "Options.hpp"
+
+using namespace std;
+
+namespace
+{
+    // Lê count inteiros separados por 'x' (ex.: "96x24x4"); sobra de texto invalida a opção.
+    bool parseInts(string_view text, int *values, int count)
+    {
+        const char *p = text.data();
+        const char *end = p + text.size();
+        for (int k = 0; k < count; ++k)
+        {
+            if (k > 0 && (p == end || *p++ != 'x'))
+                return false;
+            const auto [next, ec] = from_chars(p, end, values[k]);
+            if (ec != errc{})
+                return false;
+            p = next;
+        }
+        return p == end;
+    }
+}
+
+RunOptions parseRunOptions(int argc, char *argv[])
+{
+    RunOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string_view arg(argv[i]);
+        if (arg == "--ordered-output")
+        {
+            options.orderedOutput = true;
+        }
+        else if (arg == "--binary-output")
+        {
+            options.binaryOutput = true;
+        }
+        else if (arg == "--write-input")
+        {
+            options.writeInputFile = true;
+        }
+        else if (arg == "--item-based")
+        {
+            options.itemBased = true;
+        }
+        else if (arg == "--exact-neighbors")
+        {
+            options.exactNeighbors = true;
+        }
+        else if (arg == "--genome")
+        {
+            options.genome = true;
+        }
+        else if (arg == "--batch")
+        {
+            options.batch = true;
+        }
+        else if (arg == "--adjusted-cosine")
+        {
+            options.similarityMetric = Config::SimilarityMetric::AdjustedCosine;
+        }
+        else if (arg.substr(0, 6) == "--lsh=")
+        {
+            int shape[3];
+            if (!parseInts(arg.substr(6), shape, 3))
+            {
+                throw invalid_argument("Formato do LSH inválido: " + string(arg));
+            }
+            options.lshHashes = shape[0];
+            options.lshBands = shape[1];
+            options.lshRows = shape[2];
+        }
+        else if (arg.substr(0, 17) == "--signature-bits=")
+        {
+            if (!parseInts(arg.substr(17), &options.lshSignatureBits, 1))
+            {
+                throw invalid_argument("Número de bits inválido: " + string(arg));
+            }
+        }
+        else if (arg.substr(0, 7) == "--seed=")
+        {
+            if (!parseInts(arg.substr(7), &options.lshSeed, 1) || options.lshSeed < 0)
+            {
+                throw invalid_argument("Semente inválida: " + string(arg));
+            }
+        }
+        else if (arg == "--verbose")
+        {
+            options.verbose = true;
+        }
+        else if (arg == "--bench")
+        {
+            options.bench = true;
+        }
+        else if (arg == "--evaluate")
+        {
+            options.evaluate = true;
+        }
+        else if (arg == "--tune")
+        {
+            options.tune = true;
+        }
+        else
+        {
+            throw invalid_argument("Opção desconhecida: " + string(arg));
+        }
+    }
+
+    return options;
+}
@@ -0,0 +1,30 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include "Config.hpp"
+
+// Opções de execução lidas da linha de comando; os valores padrão vêm de Config.
+struct RunOptions
+{
+    bool orderedOutput = Config::ORDERED_OUTPUT; // Mantém a saída na mesma ordem do arquivo de usuários.
+    bool binaryOutput = Config::BINARY_OUTPUT;   // Grava a saída no formato binário compacto.
+    bool writeInputFile = Config::WRITE_INPUT_FILE; // Grava o input.dat ao pré-processar o ratings.csv.
+    bool itemBased = Config::ITEM_BASED;         // Pontua pelos vizinhos item-item em vez dos usuários similares.
+    bool exactNeighbors = Config::EXACT_NEIGHBORS; // Usa o kNN exato dos usuários em vez do LSH.
+    bool batch = Config::BATCH_RECOMMEND;        // Recomenda em grupos que compartilham os candidatos do LSH.
+    bool genome = Config::USE_GENOME;            // Soma a afinidade do Tag Genome aos candidatos.
+    int lshHashes = Config::NUM_HASH_FUNCTIONS;  // Formato do LSH (--lsh=HASHESxBANDASxLINHAS), entre os presets.
+    int lshBands = Config::NUM_BANDS;
+    int lshRows = Config::ROWS_PER_BAND;
+    int lshSignatureBits = Config::LSH_SIGNATURE_BITS; // Bits por hash na reordenação dos candidatos (--signature-bits=N).
+    int lshSeed = Config::LSH_SEED;              // Semente das funções de hash do LSH (--seed=N, 0 sorteia).
+    Config::SimilarityMetric similarityMetric = Config::SIMILARITY_METRIC; // Métrica da similaridade entre usuários.
+    bool verbose = false;                        // Imprime estatísticas de execução em stderr.
+    bool bench = false;                          // Grava tempos por estágio, latências e memória em Config::BENCH_FILE.
+    bool evaluate = false;                       // Avalia o modelo com notas retiradas em vez de gerar as recomendações.
+    bool tune = false;                           // Como evaluate, percorrendo a grade de parâmetros do LSH.
+};
+
+RunOptions parseRunOptions(int argc, char *argv[]);
+
+#endif
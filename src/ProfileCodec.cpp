@@ -0,0 +1,150 @@
+#include "ProfileCodec.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PROFILE_CODEC_X86 1
+#endif
+
+using namespace std;
+
+namespace
+{
+    inline uint32_t readVarint(const uint8_t *&bytes)
+    {
+        uint32_t value = *bytes & 0x7F;
+        int shift = 7;
+        while (*bytes++ & 0x80)
+        {
+            value |= static_cast<uint32_t>(*bytes & 0x7F) << shift;
+            shift += 7;
+        }
+        return value;
+    }
+
+    void scalarDecode(const uint8_t *bytes, size_t n, uint32_t *out)
+    {
+        uint32_t prev = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            prev += readVarint(bytes);
+            out[i] = prev;
+        }
+    }
+
+#ifdef PROFILE_CODEC_X86
+
+    // Soma de prefixos das 8 lanes, somada ao último valor decodificado.
+    __attribute__((target("avx2"))) inline __m256i prefixSum(__m256i x, uint32_t base)
+    {
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        const __m256i low = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(3));
+        x = _mm256_add_epi32(x, _mm256_blend_epi32(_mm256_setzero_si256(), low, 0xF0));
+        return _mm256_add_epi32(x, _mm256_set1_epi32(static_cast<int>(base)));
+    }
+
+    // Blocos de 16 (ou 8) bytes sem bit de continuação são 16 (ou 8) deltas inteiros: basta
+    // expandir para 32 bits e acumular. O resto cai no varint escalar.
+    __attribute__((target("avx2"))) void avx2Decode(const uint8_t *bytes, size_t n, uint32_t *out)
+    {
+        uint32_t prev = 0;
+        size_t i = 0;
+        while (i < n)
+        {
+            if (n - i >= 8)
+            {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+                const uint32_t continuation = static_cast<uint32_t>(_mm_movemask_epi8(block));
+
+                if (continuation == 0 && n - i >= 16)
+                {
+                    const __m256i lo = prefixSum(_mm256_cvtepu8_epi32(block), prev);
+                    prev = static_cast<uint32_t>(_mm256_extract_epi32(lo, 7));
+                    const __m256i hi = prefixSum(_mm256_cvtepu8_epi32(_mm_srli_si128(block, 8)), prev);
+                    prev = static_cast<uint32_t>(_mm256_extract_epi32(hi, 7));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), lo);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 8), hi);
+                    bytes += 16;
+                    i += 16;
+                    continue;
+                }
+                if ((continuation & 0xFF) == 0)
+                {
+                    const __m256i lo = prefixSum(_mm256_cvtepu8_epi32(block), prev);
+                    prev = static_cast<uint32_t>(_mm256_extract_epi32(lo, 7));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), lo);
+                    bytes += 8;
+                    i += 8;
+                    continue;
+                }
+            }
+
+            prev += readVarint(bytes);
+            out[i++] = prev;
+        }
+    }
+
+#endif
+
+    struct Decoder
+    {
+        void (*decode)(const uint8_t *, size_t, uint32_t *);
+        const char *name;
+    };
+
+    Decoder selectDecoder()
+    {
+#ifdef PROFILE_CODEC_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {avx2Decode, "avx2"};
+#endif
+        return {scalarDecode, "scalar"};
+    }
+
+    const Decoder decoder = selectDecoder();
+}
+
+size_t ProfileCodec::encodedSize(const uint32_t *items, size_t n)
+{
+    size_t bytes = 0;
+    uint32_t prev = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t delta = items[i] - prev;
+        prev = items[i];
+        do
+        {
+            ++bytes;
+            delta >>= 7;
+        } while (delta);
+    }
+    return bytes;
+}
+
+uint8_t *ProfileCodec::encode(const uint32_t *items, size_t n, uint8_t *out)
+{
+    uint32_t prev = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t delta = items[i] - prev;
+        prev = items[i];
+        while (delta >= 0x80)
+        {
+            *out++ = static_cast<uint8_t>(delta | 0x80);
+            delta >>= 7;
+        }
+        *out++ = static_cast<uint8_t>(delta);
+    }
+    return out;
+}
+
+void ProfileCodec::decode(const uint8_t *bytes, size_t n, uint32_t *out)
+{
+    decoder.decode(bytes, n, out);
+}
+
+const char *ProfileCodec::kernelName()
+{
+    return decoder.name;
+}
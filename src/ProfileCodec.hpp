@@ -0,0 +1,36 @@
+#ifndef PROFILE_CODEC_HPP
+#define PROFILE_CODEC_HPP
+
+#include "Config.hpp"
+
+// Codificação compacta dos perfis: IDs crescentes guardados como deltas em varint (LEB128)
+// e notas como códigos de meia estrela (nota * 2). A decodificação tem um caminho AVX2 para
+// blocos de deltas de um byte, escolhido em tempo de execução.
+namespace ProfileCodec
+{
+    // Bytes extras no fim do fluxo: o decodificador lê 16 bytes adiante sem checar o limite.
+    const size_t PADDING = 16;
+
+    // Número de bytes que encode() escreve para a lista crescente items[0..n).
+    size_t encodedSize(const uint32_t *items, size_t n);
+
+    // Escreve a lista em out e devolve o ponteiro após o último byte.
+    uint8_t *encode(const uint32_t *items, size_t n, uint8_t *out);
+
+    // Decodifica n IDs a partir de bytes (o fluxo precisa de PADDING bytes legíveis após o fim).
+    void decode(const uint8_t *bytes, size_t n, uint32_t *out);
+
+    inline uint8_t ratingCode(float rating)
+    {
+        return static_cast<uint8_t>(std::lround(std::clamp(rating, 0.0f, 127.0f) * 2.0f));
+    }
+
+    inline float rating(uint8_t code)
+    {
+        return code * 0.5f;
+    }
+
+    const char *kernelName();
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include "RatingStore.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+void PackedLists::assign(const vector<uint64_t> &listOffsets, const uint32_t *items, const float *ratings)
+{
+    const size_t n = listOffsets.size() - 1;
+    offsets = listOffsets;
+    byteOffsets.assign(n + 1, 0);
+    codes.resize(offsets[n]);
+
+    ThreadPool &pool = ThreadPool::instance();
+    pool.parallelFor(0, n, 4096, [&](size_t start, size_t end)
+                     {
+        for (size_t i = start; i < end; ++i) {
+            byteOffsets[i + 1] = ProfileCodec::encodedSize(items + offsets[i], length(i));
+            for (uint64_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                codes[k] = ProfileCodec::ratingCode(ratings[k]);
+        } });
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        byteOffsets[i + 1] += byteOffsets[i];
+    }
+
+    ids.assign(byteOffsets[n] + ProfileCodec::PADDING, 0);
+    pool.parallelFor(0, n, 4096, [&](size_t start, size_t end)
+                     {
+        for (size_t i = start; i < end; ++i)
+            ProfileCodec::encode(items + offsets[i], length(i), ids.data() + byteOffsets[i]); });
+}
+
+RatingRow PackedLists::decode(size_t i, RowBuffer &buffer, bool withRatings, float shift) const
+{
+    const size_t n = length(i);
+    if (buffer.items.size() < n)
+    {
+        buffer.items.resize(n);
+    }
+    decodeItems(i, buffer.items.data());
+
+    if (!withRatings)
+    {
+        return {buffer.items.data(), nullptr, n};
+    }
+
+    if (buffer.ratings.size() < n)
+    {
+        buffer.ratings.resize(n);
+    }
+    decodeRatings(i, buffer.ratings.data(), shift);
+    return {buffer.items.data(), buffer.ratings.data(), n};
+}
+
+void PackedLists::decodeItems(size_t i, uint32_t *items) const
+{
+    ProfileCodec::decode(ids.data() + byteOffsets[i], length(i), items);
+}
+
+void PackedLists::decodeRatings(size_t i, float *ratings, float shift) const
+{
+    const uint8_t *rowCodes = codes.data() + offsets[i];
+    const size_t n = length(i);
+    for (size_t k = 0; k < n; ++k)
+    {
+        ratings[k] = ProfileCodec::rating(rowCodes[k]) - shift;
+    }
+}
+
+void RatingStore::buildIdIndex()
+{
+    userIndexById.assign(userIds.empty() ? 0 : userIds.back() + 1, INVALID_INDEX);
+    for (uint32_t u = 0; u < userIds.size(); ++u)
+    {
+        userIndexById[userIds[u]] = u;
+    }
+
+    movieIndexById.assign(movieIds.empty() ? 0 : movieIds.back() + 1, INVALID_INDEX);
+    for (uint32_t m = 0; m < movieIds.size(); ++m)
+    {
+        movieIndexById[movieIds[m]] = m;
+    }
+}
+
+void RatingStore::buildTranspose()
+{
+    const size_t nm = numMovies();
+    vector<uint64_t> movieOffsets(nm + 1, 0);
+    RowBuffer buffer;
+    for (uint32_t u = 0; u < numUsers(); ++u)
+    {
+        const RatingRow row = userItems(u, buffer);
+        for (size_t i = 0; i < row.size; ++i)
+        {
+            ++movieOffsets[row.items[i] + 1];
+        }
+    }
+    for (size_t m = 0; m < nm; ++m)
+    {
+        movieOffsets[m + 1] += movieOffsets[m];
+    }
+
+    vector<uint32_t> movieUsers(numRatings());
+    vector<float> movieRatings(numRatings());
+    vector<uint64_t> cursor(movieOffsets.begin(), movieOffsets.end() - 1);
+    for (uint32_t u = 0; u < numUsers(); ++u)
+    {
+        const RatingRow row = userRow(u, buffer);
+        for (size_t i = 0; i < row.size; ++i)
+        {
+            const uint64_t pos = cursor[row.items[i]]++;
+            movieUsers[pos] = u;
+            movieRatings[pos] = row.ratings[i];
+        }
+    }
+
+    movieLists.assign(movieOffsets, movieUsers.data(), movieRatings.data());
+}
+
+void RatingStore::computeAggregates()
+{
+    const size_t nu = numUsers();
+    const size_t nm = numMovies();
+
+    userAvgRating.assign(nu, 0.0f);
+    userNorm.assign(nu, 0.0f);
+    userCenteredNorm.assign(nu, 0.0f);
+    userPreferredGenres.assign(nu, 0);
+    movieAvgRating.assign(nm, 0.0f);
+    moviePopularity.assign(nm, 0);
+    movieGenres.resize(nm, 0);
+
+    vector<double> movieSums(nm, 0.0);
+    double totalSum = 0.0;
+
+    RowBuffer buffer;
+    for (uint32_t u = 0; u < nu; ++u)
+    {
+        const RatingRow row = userRow(u, buffer);
+        float sumRatings = 0.0f;
+        for (size_t i = 0; i < row.size; ++i)
+        {
+            sumRatings += row.ratings[i];
+            movieSums[row.items[i]] += row.ratings[i];
+            ++moviePopularity[row.items[i]];
+        }
+        if (row.size > 0)
+        {
+            userAvgRating[u] = sumRatings / row.size;
+        }
+        totalSum += sumRatings;
+
+        float sumSquares = 0.0f;
+        float centeredSquares = 0.0f;
+        for (size_t i = 0; i < row.size; ++i)
+        {
+            const float centered = row.ratings[i] - userAvgRating[u];
+            sumSquares += row.ratings[i] * row.ratings[i];
+            centeredSquares += centered * centered;
+        }
+        userNorm[u] = sqrt(sumSquares);
+        userCenteredNorm[u] = sqrt(centeredSquares);
+    }
+
+    for (size_t m = 0; m < nm; ++m)
+    {
+        if (moviePopularity[m] > 0)
+        {
+            movieAvgRating[m] = static_cast<float>(movieSums[m] / moviePopularity[m]);
+        }
+    }
+
+    globalAvgRating = numRatings() > 0 ? static_cast<float>(totalSum / numRatings()) : 0.0f;
+    buildPopularityRanking();
+}
+
+void RatingStore::buildPopularityRanking()
+{
+    popularityRanking.clear();
+    for (uint32_t m = 0; m < numMovies(); ++m)
+    {
+        if (movieAvgRating[m] >= Config::MIN_RATING)
+        {
+            popularityRanking.push_back(m);
+        }
+    }
+
+    sort(popularityRanking.begin(), popularityRanking.end(), [this](uint32_t a, uint32_t b)
+         {
+        const float scoreA = popularityScore(a);
+        const float scoreB = popularityScore(b);
+        return scoreA != scoreB ? scoreA > scoreB : a < b; });
+}
@@ -0,0 +1,113 @@
+#ifndef RATING_STORE_HPP
+#define RATING_STORE_HPP
+
+#include "Config.hpp"
+#include "ProfileCodec.hpp"
+
+struct RatingRow
+{
+    const uint32_t *items;
+    const float *ratings;
+    size_t size;
+};
+
+// Destino da decodificação de uma linha. Cada chamador mantém o seu (thread_local ou na pilha,
+// quando a linha precisa sobreviver a uma espera no pool).
+struct RowBuffer
+{
+    std::vector<uint32_t> items;
+    std::vector<float> ratings;
+};
+
+// Listas crescentes de IDs em delta-varint, com as notas em códigos de meia estrela.
+struct PackedLists
+{
+    std::vector<uint64_t> offsets;     // início de cada lista, em itens (também indexa codes)
+    std::vector<uint64_t> byteOffsets; // início de cada lista em ids
+    std::vector<uint8_t> ids;          // termina com ProfileCodec::PADDING bytes zerados
+    std::vector<uint8_t> codes;
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    size_t length(size_t i) const { return offsets[i + 1] - offsets[i]; }
+
+    void assign(const std::vector<uint64_t> &listOffsets, const uint32_t *items, const float *ratings);
+
+    // shift é subtraído de cada nota (a média do usuário, para as notas centradas).
+    RatingRow decode(size_t i, RowBuffer &buffer, bool withRatings = true, float shift = 0.0f) const;
+
+    // Decodificam direto em arrays do chamador, com espaço para length(i) itens.
+    void decodeItems(size_t i, uint32_t *items) const;
+    void decodeRatings(size_t i, float *ratings, float shift = 0.0f) const;
+};
+
+// Matriz de avaliações com IDs remapeados para índices densos, ordenados pelo ID externo.
+// CSR (usuário -> filmes) e, opcionalmente, CSC (filme -> usuários), ambos comprimidos em PackedLists,
+// com agregados em arrays paralelos.
+struct RatingStore
+{
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    std::vector<uint32_t> userIds;
+    std::vector<uint32_t> movieIds;
+    std::vector<uint32_t> userIndexById;
+    std::vector<uint32_t> movieIndexById;
+
+    PackedLists userLists;
+    PackedLists movieLists;
+
+    std::vector<float> userAvgRating;
+    std::vector<float> userNorm;         // norma L2 das notas do perfil
+    std::vector<float> userCenteredNorm; // norma L2 das notas menos userAvgRating
+    std::vector<uint32_t> userPreferredGenres;
+
+    std::vector<float> movieAvgRating;
+    std::vector<int> moviePopularity;
+    std::vector<uint32_t> movieGenres;
+    std::vector<uint32_t> popularityRanking; // filmes com média >= MIN_RATING, por popularityScore decrescente
+
+    float globalAvgRating = 0.0f;
+
+    size_t numUsers() const { return userIds.size(); }
+    size_t numMovies() const { return movieIds.size(); }
+    size_t numRatings() const { return userLists.codes.size(); }
+
+    uint32_t userIndex(uint32_t userId) const
+    {
+        return userId < userIndexById.size() ? userIndexById[userId] : INVALID_INDEX;
+    }
+
+    uint32_t movieIndex(uint32_t movieId) const
+    {
+        return movieId < movieIndexById.size() ? movieIndexById[movieId] : INVALID_INDEX;
+    }
+
+    size_t userRowSize(uint32_t u) const { return userLists.length(u); }
+
+    RatingRow userRow(uint32_t u, RowBuffer &buffer) const { return userLists.decode(u, buffer); }
+
+    // Notas menos a média do usuário, usadas pelo cosseno ajustado e pelo CF.
+    RatingRow userCenteredRow(uint32_t u, RowBuffer &buffer) const
+    {
+        return userLists.decode(u, buffer, true, userAvgRating[u]);
+    }
+
+    // Só os filmes (ratings == nullptr), para interseções e MinHash.
+    RatingRow userItems(uint32_t u, RowBuffer &buffer) const { return userLists.decode(u, buffer, false); }
+
+    RatingRow movieColumn(uint32_t m, RowBuffer &buffer) const { return movieLists.decode(m, buffer); }
+
+    // Score usado pelo fallback por popularidade.
+    float popularityScore(uint32_t m) const
+    {
+        return moviePopularity[m] * movieAvgRating[m] * Config::POPULARITY_WEIGHT;
+    }
+
+    bool hasTranspose() const { return movieLists.offsets.size() == numMovies() + 1; }
+
+    void buildIdIndex();
+    void buildTranspose();
+    void computeAggregates();
+    void buildPopularityRanking();
+};
+
+#endif
@@ -1,83 +1,246 @@
 #include "RecommendationEngine.hpp"
+#include "Intersection.hpp"
+#include "ThreadPool.hpp"
 
 using namespace std;
 
 RecommendationEngine::RecommendationEngine(
-    const unordered_map<uint32_t, UserProfile> &u,
+    const RatingStore &s,
     const unordered_map<uint32_t, Movie> &m,
-    const unordered_map<uint32_t, vector<pair<uint32_t, float>>> &mtu,
-    const unordered_map<uint32_t, vector<uint32_t>> &gtm,
-    const unordered_map<uint32_t, float> &mar,
-    const unordered_map<uint32_t, int> &mp,
-    float gar,
+    const vector<vector<uint32_t>> &gtm,
     SimilarityCalculator &sc,
-    LSHIndex &lsh) : users(u), movies(m), movieToUsers(mtu), genreToMovies(gtm),
-                     movieAvgRatings(mar), moviePopularity(mp), globalAvgRating(gar),
-                     similarityCalc(sc), lshIndex(lsh) {}
+    LSHIndex &lsh,
+    const ItemNeighbors &items,
+    const UserNeighbors &users,
+    const ContentBoostIndex &cb,
+    const TagGenome &tg) : store(s), movies(m), genreToMovies(gtm),
+                           similarityCalc(sc), lshIndex(lsh), itemNeighbors(items),
+                           userNeighbors(users), contentBoost(cb), genome(tg) {}
 
 vector<Recommendation> RecommendationEngine::recommendForUser(uint32_t userId)
 {
-    auto it = users.find(userId);
-    if (it == users.end())
+    const uint32_t userIdx = store.userIndex(userId);
+    if (userIdx == RatingStore::INVALID_INDEX)
     {
         return {};
     }
 
-    const UserProfile &user = it->second;
+    // Na pilha: calculateSimilarities espera no pool e pode executar outro usuário nesta thread.
+    // A linha fica na representação da métrica de similaridade; o modo item a item usa as notas centradas.
+    RowBuffer userBuffer;
+    const RatingRow user = itemNeighbors.empty() ? similarityCalc.profile(userIdx, userBuffer)
+                                                 : store.userCenteredRow(userIdx, userBuffer);
 
-    unordered_set<uint32_t> watchedMovies;
-    for (const auto &[movieId, _] : user.ratings)
+    if (!itemNeighbors.empty())
     {
-        watchedMovies.insert(movieId);
+        ScoreBoard &board = scoreBoard(user);
+        itemBasedFiltering(user, board);
+        return finishRecommendations(userIdx, board);
     }
 
-    vector<pair<uint32_t, int>> candidates = findCandidateUsersLSH(userId, user);
+    // O kNN exato já traz os vizinhos com as similaridades finais: sem LSH nem calculateSimilarities.
+    if (userNeighbors.contains(userIdx))
+    {
+        const UserNeighbors::Row neighbors = userNeighbors.neighbors(userIdx);
+        vector<pair<uint32_t, float>> similarUsers(neighbors.size);
+        for (size_t i = 0; i < neighbors.size; ++i)
+        {
+            similarUsers[i] = {neighbors.items[i].user, neighbors.items[i].similarity};
+        }
 
-    auto similarUsers = calculateSimilarities(userId, candidates);
-    auto scores = collaborativeFiltering(user, similarUsers, watchedMovies);
-    contentBasedBoost(user, watchedMovies, scores);
+        ScoreBoard &board = scoreBoard(user);
+        collaborativeFiltering(similarUsers, board, nullptr);
+        return finishRecommendations(userIdx, board);
+    }
+
+    const vector<uint32_t> lshCandidates = lshIndex.findSimilarCandidates(userIdx, Config::MAX_CANDIDATES * 3);
+    vector<pair<uint32_t, int>> candidates = findCandidateUsersLSH(user, lshCandidates, nullptr);
+    auto similarUsers = calculateSimilarities(userIdx, user, candidates, nullptr);
+
+    // O placar da thread só é usado depois da espera em calculateSimilarities.
+    ScoreBoard &board = scoreBoard(user);
+    collaborativeFiltering(similarUsers, board, nullptr);
+    return finishRecommendations(userIdx, board);
+}
 
-    if (scores.size() < Config::TOP_K)
+vector<vector<Recommendation>> RecommendationEngine::recommendForUsers(const vector<uint32_t> &userIds)
+{
+    vector<vector<Recommendation>> results(userIds.size());
+    // Sem candidatos do LSH não há bloco a compartilhar.
+    if (!itemNeighbors.empty() || !userNeighbors.empty())
     {
-        popularityFallback(watchedMovies, scores);
+        for (size_t q = 0; q < userIds.size(); ++q)
+        {
+            results[q] = recommendForUser(userIds[q]);
+        }
+        return results;
     }
 
-    vector<Recommendation> recommendations;
-    recommendations.reserve(scores.size());
+    struct Query
+    {
+        uint32_t userIdx;
+        RowBuffer buffer;
+        RatingRow row;
+        vector<uint32_t> lshCandidates;
+    };
+
+    vector<Query> queries(userIds.size());
+    vector<uint32_t> groupCandidates;
+    for (size_t q = 0; q < userIds.size(); ++q)
+    {
+        Query &query = queries[q];
+        query.userIdx = store.userIndex(userIds[q]);
+        if (query.userIdx == RatingStore::INVALID_INDEX)
+            continue;
 
-    for (const auto &[movieId, score] : scores)
+        query.row = similarityCalc.profile(query.userIdx, query.buffer);
+        query.lshCandidates = lshIndex.findSimilarCandidates(query.userIdx, Config::MAX_CANDIDATES * 3);
+        groupCandidates.insert(groupCandidates.end(), query.lshCandidates.begin(), query.lshCandidates.end());
+    }
+
+    // Na pilha pelo mesmo motivo do userBuffer de recommendForUser.
+    CandidateBlock block;
+    block.build(store, similarityCalc.centered(), move(groupCandidates));
+
+    for (size_t q = 0; q < userIds.size(); ++q)
     {
-        recommendations.emplace_back(movieId, score);
+        const Query &query = queries[q];
+        if (query.userIdx == RatingStore::INVALID_INDEX)
+            continue;
+
+        vector<pair<uint32_t, int>> candidates = findCandidateUsersLSH(query.row, query.lshCandidates, &block);
+        auto similarUsers = calculateSimilarities(query.userIdx, query.row, candidates, &block);
+
+        ScoreBoard &board = scoreBoard(query.row);
+        collaborativeFiltering(similarUsers, board, &block);
+        results[q] = finishRecommendations(query.userIdx, board);
     }
+    return results;
+}
 
-    sort(recommendations.begin(), recommendations.end(),
-         [](const auto &a, const auto &b)
-         { return a.score > b.score; });
+void RecommendationEngine::CandidateBlock::build(const RatingStore &store, bool centeredValues, vector<uint32_t> candidates)
+{
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+    users = move(candidates);
+
+    offsets.assign(users.size() + 1, 0);
+    for (size_t i = 0; i < users.size(); ++i)
+    {
+        offsets[i + 1] = offsets[i] + store.userRowSize(users[i]);
+    }
+
+    items.resize(offsets.back());
+    centered.resize(offsets.back());
+    values.resize(centeredValues ? 0 : offsets.back());
+    for (size_t i = 0; i < users.size(); ++i)
+    {
+        const uint32_t u = users[i];
+        store.userLists.decodeItems(u, items.data() + offsets[i]);
+        store.userLists.decodeRatings(u, centered.data() + offsets[i], store.userAvgRating[u]);
+        if (!centeredValues)
+            store.userLists.decodeRatings(u, values.data() + offsets[i]);
+    }
+}
+
+RatingRow RecommendationEngine::CandidateBlock::row(uint32_t user) const
+{
+    const size_t i = lower_bound(users.begin(), users.end(), user) - users.begin();
+    const float *rowValues = values.empty() ? centered.data() : values.data();
+    return {items.data() + offsets[i], rowValues + offsets[i], offsets[i + 1] - offsets[i]};
+}
+
+RatingRow RecommendationEngine::CandidateBlock::centeredRow(uint32_t user) const
+{
+    const size_t i = lower_bound(users.begin(), users.end(), user) - users.begin();
+    return {items.data() + offsets[i], centered.data() + offsets[i], offsets[i + 1] - offsets[i]};
+}
+
+void RecommendationEngine::ScoreBoard::reset(size_t numMovies)
+{
+    if (scoreStamps.size() < numMovies)
+    {
+        scores.assign(numMovies, 0.0f);
+        weights.assign(numMovies, 0.0f);
+        scoreStamps.assign(numMovies, 0);
+        watchedStamps.assign(numMovies, 0);
+        generation = 0;
+    }
+
+    touched.clear();
+    if (++generation == 0)
+    {
+        fill(scoreStamps.begin(), scoreStamps.end(), 0);
+        fill(watchedStamps.begin(), watchedStamps.end(), 0);
+        generation = 1;
+    }
+}
+
+RecommendationEngine::ScoreBoard &RecommendationEngine::scoreBoard(const RatingRow &user) const
+{
+    thread_local ScoreBoard board;
+    board.reset(store.numMovies());
+    for (size_t i = 0; i < user.size; ++i)
+    {
+        board.watchedStamps[user.items[i]] = board.generation;
+    }
+    return board;
+}
+
+// Seleciona os TOP_K melhores com um heap limitado (o topo é o pior dos escolhidos);
+// empates ficam com o menor movieId.
+vector<Recommendation> RecommendationEngine::finishRecommendations(uint32_t userIdx, ScoreBoard &board)
+{
+    genomeAffinity(userIdx, board);
+    contentBasedBoost(userIdx, board);
+
+    if (board.touched.size() < Config::TOP_K)
+    {
+        popularityFallback(board);
+    }
 
-    if (recommendations.size() > Config::TOP_K)
+    auto better = [](const Recommendation &a, const Recommendation &b)
     {
-        recommendations.resize(Config::TOP_K);
+        return a.score != b.score ? a.score > b.score : a.movieId < b.movieId;
+    };
+
+    vector<Recommendation> recommendations;
+    recommendations.reserve(Config::TOP_K);
+    for (const uint32_t movieIdx : board.touched)
+    {
+        const Recommendation candidate(store.movieIds[movieIdx], board.scores[movieIdx]);
+        if (recommendations.size() < Config::TOP_K)
+        {
+            recommendations.push_back(candidate);
+            push_heap(recommendations.begin(), recommendations.end(), better);
+        }
+        else if (better(candidate, recommendations.front()))
+        {
+            pop_heap(recommendations.begin(), recommendations.end(), better);
+            recommendations.back() = candidate;
+            push_heap(recommendations.begin(), recommendations.end(), better);
+        }
     }
+    sort_heap(recommendations.begin(), recommendations.end(), better);
 
     return recommendations;
 }
 
 vector<pair<uint32_t, int>> RecommendationEngine::findCandidateUsers(
-    uint32_t userId,
-    const UserProfile &user)
+    uint32_t userIdx,
+    const RatingRow &user)
 {
     unordered_map<uint32_t, int> candidateCount;
-    for (const auto &[movieId, _] : user.ratings)
+    thread_local RowBuffer buffer;
+    for (size_t i = 0; i < user.size; ++i)
     {
-        auto it = movieToUsers.find(movieId);
-        if (it != movieToUsers.end())
+        const RatingRow raters = store.movieColumn(user.items[i], buffer);
+        for (size_t j = 0; j < raters.size; ++j)
         {
-            for (const auto &[otherUser, _] : it->second)
+            const uint32_t otherUser = raters.items[j];
+            if (otherUser != userIdx)
             {
-                if (otherUser != userId)
-                {
-                    candidateCount[otherUser]++;
-                }
+                candidateCount[otherUser]++;
             }
         }
     }
@@ -104,31 +267,30 @@ vector<pair<uint32_t, int>> RecommendationEngine::findCandidateUsers(
 }
 
 vector<pair<uint32_t, float>> RecommendationEngine::calculateSimilarities(
-    uint32_t userId,
-    const vector<pair<uint32_t, int>> &candidates)
+    uint32_t userIdx,
+    const RatingRow &user,
+    const vector<pair<uint32_t, int>> &candidates,
+    const CandidateBlock *block)
 {
+    vector<float> similarities(candidates.size());
+    ThreadPool::instance().parallelFor(0, candidates.size(), Config::BATCH_SIZE,
+                                       [this, userIdx, &user, &candidates, &similarities, block](size_t begin, size_t end)
+                                       {
+                                           for (size_t j = begin; j < end; ++j)
+                                           {
+                                               const uint32_t candidate = candidates[j].first;
+                                               similarities[j] = block
+                                                                     ? similarityCalc.calculateCosineSimilarity(userIdx, user, candidate, block->row(candidate))
+                                                                     : similarityCalc.calculateCosineSimilarity(userIdx, user, candidate);
+                                           }
+                                       });
+
     vector<pair<uint32_t, float>> similarUsers;
-    for (size_t i = 0; i < candidates.size(); i += Config::BATCH_SIZE)
+    for (size_t j = 0; j < candidates.size(); ++j)
     {
-        size_t end = min(i + Config::BATCH_SIZE, candidates.size());
-        vector<future<pair<uint32_t, float>>> futures;
-        for (size_t j = i; j < end; ++j)
+        if (similarities[j] > Config::MIN_SIMILARITY)
         {
-            uint32_t candidateId = candidates[j].first;
-            futures.push_back(async(launch::async,
-                                    [this, userId, candidateId]()
-                                    {
-                                        float sim = similarityCalc.calculateCosineSimilarity(userId, candidateId);
-                                        return make_pair(candidateId, sim);
-                                    }));
-        }
-        for (auto &f : futures)
-        {
-            auto result = f.get();
-            if (result.second > Config::MIN_SIMILARITY)
-            {
-                similarUsers.push_back(result);
-            }
+            similarUsers.push_back({candidates[j].first, similarities[j]});
         }
     }
 
@@ -143,160 +305,142 @@ vector<pair<uint32_t, float>> RecommendationEngine::calculateSimilarities(
     return similarUsers;
 }
 
-unordered_map<uint32_t, float> RecommendationEngine::collaborativeFiltering(
-    const UserProfile &user,
+void RecommendationEngine::collaborativeFiltering(
     const vector<pair<uint32_t, float>> &similarUsers,
-    const unordered_set<uint32_t> &watchedMovies)
+    ScoreBoard &board,
+    const CandidateBlock *block)
 {
-    (void)user;
-    unordered_map<uint32_t, float> scores;
     float totalSim = 0;
-    for (const auto &[simUserId, similarity] : similarUsers)
+    thread_local RowBuffer buffer;
+    for (const auto &[simUserIdx, similarity] : similarUsers)
     {
         totalSim += similarity;
-        auto it = users.find(simUserId);
-        if (it == users.end())
-            continue;
 
-        const auto &simUserRatings = it->second.ratings;
-        float simUserAvg = it->second.avgRating;
-        for (const auto &[movieId, rating] : simUserRatings)
+        const RatingRow simUserRatings = block ? block->centeredRow(simUserIdx) : store.userCenteredRow(simUserIdx, buffer);
+        for (size_t i = 0; i < simUserRatings.size; ++i)
         {
-            if (watchedMovies.find(movieId) == watchedMovies.end())
+            const uint32_t movieIdx = simUserRatings.items[i];
+            if (!board.watched(movieIdx))
             {
-                scores[movieId] += similarity * (rating - simUserAvg);
+                board.add(movieIdx, similarity * simUserRatings.ratings[i]);
             }
         }
     }
 
     if (totalSim > 0)
     {
-        for (auto &[movieId, score] : scores)
+        for (const uint32_t movieIdx : board.touched)
         {
+            float &score = board.scores[movieIdx];
             score = score / totalSim;
-            auto it = movieAvgRatings.find(movieId);
-            if (it != movieAvgRatings.end())
-            {
-                score += it->second;
-            }
+            score += store.movieAvgRating[movieIdx];
         }
     }
 
-    for (auto &[movieId, score] : scores)
+    for (const uint32_t movieIdx : board.touched)
     {
-        auto popIt = moviePopularity.find(movieId);
-        if (popIt != moviePopularity.end())
+        float popularity_boost = log(store.moviePopularity[movieIdx] + 1) / 15.0f;
+        board.scores[movieIdx] += popularity_boost * Config::POPULARITY_WEIGHT;
+    }
+}
+
+// Custo O(perfil x ITEM_NEIGHBORS): cada filme visto empresta o desvio da nota do usuário
+// (user vem com as notas centradas) aos seus vizinhos, ponderado pela similaridade item-item.
+void RecommendationEngine::itemBasedFiltering(const RatingRow &user, ScoreBoard &board)
+{
+    for (size_t i = 0; i < user.size; ++i)
+    {
+        const float deviation = user.ratings[i];
+        const ItemNeighbors::Row row = itemNeighbors.neighbors(user.items[i]);
+        for (size_t k = 0; k < row.size; ++k)
         {
-            float popularity_boost = log(popIt->second + 1) / 15.0f;
-            score += popularity_boost * Config::POPULARITY_WEIGHT;
+            const ItemNeighbors::Neighbor &neighbor = row.items[k];
+            if (!board.watched(neighbor.movie))
+            {
+                board.add(neighbor.movie, neighbor.similarity * deviation, neighbor.similarity);
+            }
         }
     }
 
-    return scores;
+    for (const uint32_t movieIdx : board.touched)
+    {
+        float score = store.movieAvgRating[movieIdx] + board.scores[movieIdx] / (board.weights[movieIdx] + Config::ITEM_SHRINKAGE);
+        float popularity_boost = log(store.moviePopularity[movieIdx] + 1) / 15.0f;
+        board.scores[movieIdx] = score + popularity_boost * Config::POPULARITY_WEIGHT;
+    }
 }
 
-void RecommendationEngine::contentBasedBoost(
-    const UserProfile &user,
-    const unordered_set<uint32_t> &watchedMovies,
-    unordered_map<uint32_t, float> &scores)
+void RecommendationEngine::genomeAffinity(uint32_t userIdx, ScoreBoard &board)
 {
-    if (user.preferredGenres == 0)
+    if (genome.empty() || board.touched.empty())
+        return;
+
+    RowBuffer buffer;
+    TagGenome::Taste taste;
+    if (!genome.taste(store.userRow(userIdx, buffer), taste))
         return;
 
-    for (int i = 0; i < 32; ++i)
+    for (const uint32_t movieIdx : board.touched)
     {
-        if (user.preferredGenres & (1 << i))
-        {
-            auto it = genreToMovies.find(i);
-            if (it != genreToMovies.end())
-            {
-                for (uint32_t movieId : it->second)
-                {
-                    if (watchedMovies.find(movieId) == watchedMovies.end())
-                    {
-                        auto avgIt = movieAvgRatings.find(movieId);
-                        auto popIt = moviePopularity.find(movieId);
-                        if (avgIt != movieAvgRatings.end() && popIt != moviePopularity.end())
-                        {
-                            float quality = avgIt->second / 5.0f;
-                            float popularity = min(1.0f, static_cast<float>(log(popIt->second + 1) / 10.0));
-
-                            float combined_boost = (0.3f * quality + 0.7f * popularity) * Config::CB_WEIGHT +
-                                                   popularity * Config::POPULARITY_WEIGHT;
-
-                            scores[movieId] += combined_boost;
-                        }
-                    }
-                }
-            }
-        }
+        board.scores[movieIdx] += genome.affinity(taste, movieIdx) * Config::GENOME_WEIGHT;
     }
 }
 
-void RecommendationEngine::popularityFallback(
-    const unordered_set<uint32_t> &watchedMovies,
-    unordered_map<uint32_t, float> &scores)
+// Os filmes já pontuados pelo CF recebem o boost direto. Os demais só têm o boost como score,
+// então apenas os TOP_K de maior boost entre eles podem entrar no top-K.
+void RecommendationEngine::contentBasedBoost(uint32_t userIdx, ScoreBoard &board)
 {
-    vector<pair<uint32_t, float>> popularMovies;
-    for (const auto &[movieId, popularity] : moviePopularity)
+    const uint32_t preferredGenres = store.userPreferredGenres[userIdx];
+    if (preferredGenres == 0 || contentBoost.empty())
+        return;
+
+    for (const uint32_t movieIdx : board.touched)
     {
-        if (watchedMovies.find(movieId) == watchedMovies.end())
-        {
-            auto it = movieAvgRatings.find(movieId);
-            if (it != movieAvgRatings.end() && it->second >= Config::MIN_RATING)
-            {
-                float weighted_score = popularity * it->second * Config::POPULARITY_WEIGHT;
-                popularMovies.push_back({movieId, weighted_score});
-            }
-        }
+        board.scores[movieIdx] = contentBoost.addBoost(board.scores[movieIdx], movieIdx, preferredGenres);
     }
 
-    sort(popularMovies.begin(), popularMovies.end(),
-         [](const auto &a, const auto &b)
-         { return a.second > b.second; });
+    contentBoost.forEachTop(
+        preferredGenres, Config::TOP_K,
+        [&](uint32_t movieIdx)
+        { return !board.watched(movieIdx) && !board.scored(movieIdx); },
+        [&](const ContentBoostIndex::Entry &entry)
+        { board.add(entry.movie, entry.boost); });
+}
 
-    int needed = Config::TOP_K - scores.size();
-    for (int i = 0; i < min(needed, (int)popularMovies.size()); ++i)
+// Percorre o ranking global pulando os filmes já vistos; dos `needed` primeiros restantes, entram
+// os que o CF e o boost ainda não pontuaram.
+void RecommendationEngine::popularityFallback(ScoreBoard &board)
+{
+    int needed = Config::TOP_K - board.touched.size();
+    for (const uint32_t movieIdx : store.popularityRanking)
     {
-        if (scores.find(popularMovies[i].first) == scores.end())
+        if (needed <= 0)
+            break;
+        if (board.watched(movieIdx))
+            continue;
+
+        --needed;
+        if (!board.scored(movieIdx))
         {
-            scores[popularMovies[i].first] = popularMovies[i].second / 50.0f; 
+            board.add(movieIdx, store.popularityScore(movieIdx) / 50.0f);
         }
     }
 }
 
 vector<pair<uint32_t, int>> RecommendationEngine::findCandidateUsersLSH(
-    uint32_t userId,
-    const UserProfile &user)
+    const RatingRow &user,
+    const vector<uint32_t> &lshCandidates,
+    const CandidateBlock *block)
 {
-    vector<uint32_t> lshCandidates = lshIndex.findSimilarCandidates(userId, Config::MAX_CANDIDATES * 3);
-
-
     vector<pair<uint32_t, int>> allFoundCandidates;
     allFoundCandidates.reserve(lshCandidates.size());
 
+    thread_local RowBuffer buffer;
     for (uint32_t candidateId : lshCandidates)
     {
-        auto it = users.find(candidateId);
-        if (it == users.end())
-            continue;
-
-        const auto &candidateRatings = it->second.ratings;
-        int commonCount = 0;
-        size_t i = 0, j = 0;
-        while (i < user.ratings.size() && j < candidateRatings.size())
-        {
-            if (user.ratings[i].first < candidateRatings[j].first)
-                i++;
-            else if (user.ratings[i].first > candidateRatings[j].first)
-                j++;
-            else
-            {
-                commonCount++;
-                i++;
-                j++;
-            }
-        }
+        const RatingRow candidateRatings = block ? block->row(candidateId) : store.userItems(candidateId, buffer);
+        const int commonCount = static_cast<int>(Intersection::count(
+            user.items, user.size, candidateRatings.items, candidateRatings.size));
         if (commonCount > 0)
         {
             allFoundCandidates.push_back({candidateId, commonCount});
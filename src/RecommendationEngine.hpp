@@ -3,65 +3,137 @@
 
 #include "Config.hpp"
 #include "DataStructures.hpp"
+#include "RatingStore.hpp"
 #include "SimilarityCalculator.hpp"
 #include "LSHIndex.hpp"
+#include "ItemNeighbors.hpp"
+#include "UserNeighbors.hpp"
+#include "ContentBoost.hpp"
+#include "TagGenome.hpp"
 
 using namespace std;
 
 class RecommendationEngine
 {
 private:
-    const std::unordered_map<uint32_t, UserProfile> &users;
+    const RatingStore &store;
     const std::unordered_map<uint32_t, Movie> &movies;
-    const std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, float>>> &movieToUsers;
-    const std::unordered_map<uint32_t, std::vector<uint32_t>> &genreToMovies;
-    const std::unordered_map<uint32_t, float> &movieAvgRatings;
-    const std::unordered_map<uint32_t, int> &moviePopularity;
-    float globalAvgRating;
+    const std::vector<std::vector<uint32_t>> &genreToMovies;
 
     SimilarityCalculator &similarityCalc;
     LSHIndex &lshIndex;
+    const ItemNeighbors &itemNeighbors;
+    const UserNeighbors &userNeighbors;
+    const ContentBoostIndex &contentBoost;
+    const TagGenome &genome;
 
 public:
+    // Com a tabela item-item carregada, o CF usa os vizinhos dos filmes do usuário; com o kNN
+    // exato do usuário, os vizinhos dele; senão os usuários similares encontrados pelo LSH.
     RecommendationEngine(
-        const std::unordered_map<uint32_t, UserProfile> &u,
+        const RatingStore &s,
         const std::unordered_map<uint32_t, Movie> &m,
-        const std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, float>>> &mtu,
-        const std::unordered_map<uint32_t, std::vector<uint32_t>> &gtm,
-        const std::unordered_map<uint32_t, float> &mar,
-        const std::unordered_map<uint32_t, int> &mp,
-        float gar,
+        const std::vector<std::vector<uint32_t>> &gtm,
         SimilarityCalculator &sc,
-        LSHIndex &lshIndex);
+        LSHIndex &lshIndex,
+        const ItemNeighbors &itemNeighbors,
+        const UserNeighbors &userNeighbors,
+        const ContentBoostIndex &contentBoost,
+        const TagGenome &genome);
 
     std::vector<Recommendation> recommendForUser(uint32_t userId);
 
+    // Recomenda para um grupo de usuários (de preferência com buckets LSH em comum): os perfis
+    // de todos os candidatos do grupo são decodificados uma única vez num bloco compartilhado,
+    // lido pelas similaridades e pelo CF de cada usuário. O resultado é o de recommendForUser.
+    std::vector<std::vector<Recommendation>> recommendForUsers(const std::vector<uint32_t> &userIds);
+
 private:
+    // Perfis dos candidatos de um grupo, ordenados pelo índice do usuário. values guarda as
+    // notas cruas (vazio quando a métrica já usa as centradas).
+    struct CandidateBlock
+    {
+        std::vector<uint32_t> users;
+        std::vector<uint64_t> offsets;
+        std::vector<uint32_t> items;
+        std::vector<float> values;
+        std::vector<float> centered;
+
+        void build(const RatingStore &store, bool centeredValues, std::vector<uint32_t> candidates);
+
+        // Linha na representação da métrica; o usuário precisa estar no bloco.
+        RatingRow row(uint32_t user) const;
+
+        RatingRow centeredRow(uint32_t user) const;
+    };
+
+    // Acumuladores densos por filme, reaproveitados por thread. Um filme está visto quando
+    // watchedStamps == generation e pontuado quando scoreStamps == generation, então trocar
+    // de usuário não exige limpar os arrays.
+    struct ScoreBoard
+    {
+        std::vector<float> scores;
+        std::vector<float> weights; // soma das similaridades (modo item a item)
+        std::vector<uint32_t> scoreStamps;
+        std::vector<uint32_t> watchedStamps;
+        std::vector<uint32_t> touched;
+        uint32_t generation = 0;
+
+        void reset(size_t numMovies);
+
+        bool watched(uint32_t movieIdx) const { return watchedStamps[movieIdx] == generation; }
+        bool scored(uint32_t movieIdx) const { return scoreStamps[movieIdx] == generation; }
+
+        void add(uint32_t movieIdx, float value, float weight = 0.0f)
+        {
+            if (scoreStamps[movieIdx] != generation)
+            {
+                scoreStamps[movieIdx] = generation;
+                scores[movieIdx] = 0.0f;
+                weights[movieIdx] = 0.0f;
+                touched.push_back(movieIdx);
+            }
+            scores[movieIdx] += value;
+            weights[movieIdx] += weight;
+        }
+    };
+
+    // Placar da thread, zerado e com os filmes de user marcados como vistos. Não pode
+    // atravessar uma espera no pool (a thread pode executar outro usuário nela).
+    ScoreBoard &scoreBoard(const RatingRow &user) const;
+
+    std::vector<Recommendation> finishRecommendations(uint32_t userIdx, ScoreBoard &board);
+
     std::vector<std::pair<uint32_t, int>> findCandidateUsers(
-        uint32_t userId,
-        const UserProfile &user);
+        uint32_t userIdx,
+        const RatingRow &user);
 
     std::vector<std::pair<uint32_t, float>> calculateSimilarities(
-        uint32_t userId,
-        const std::vector<std::pair<uint32_t, int>> &candidates);
+        uint32_t userIdx,
+        const RatingRow &user,
+        const std::vector<std::pair<uint32_t, int>> &candidates,
+        const CandidateBlock *block);
 
-    std::unordered_map<uint32_t, float> collaborativeFiltering(
-        const UserProfile &user,
+    void collaborativeFiltering(
         const std::vector<std::pair<uint32_t, float>> &similarUsers,
-        const std::unordered_set<uint32_t> &watchedMovies);
+        ScoreBoard &board,
+        const CandidateBlock *block);
+
+    // user vem com as notas centradas.
+    void itemBasedFiltering(const RatingRow &user, ScoreBoard &board);
+
+    // Soma GENOME_WEIGHT vezes a afinidade de tags aos filmes já pontuados (Tag Genome carregado).
+    void genomeAffinity(uint32_t userIdx, ScoreBoard &board);
 
-    void contentBasedBoost(
-        const UserProfile &user,
-        const std::unordered_set<uint32_t> &watchedMovies,
-        std::unordered_map<uint32_t, float> &scores);
+    void contentBasedBoost(uint32_t userIdx, ScoreBoard &board);
 
-    void popularityFallback(
-        const std::unordered_set<uint32_t> &watchedMovies,
-        std::unordered_map<uint32_t, float> &scores);
+    void popularityFallback(ScoreBoard &board);
 
+    // Com bloco, os perfis dos candidatos vêm dele; senão são decodificados da RatingStore.
     std::vector<std::pair<uint32_t, int>> findCandidateUsersLSH(
-        uint32_t userId,
-        const UserProfile &user);
+        const RatingRow &user,
+        const std::vector<uint32_t> &lshCandidates,
+        const CandidateBlock *block);
 };
 
-#endif 
\ No newline at end of file
+#endif
\ No newline at end of file
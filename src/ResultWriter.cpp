@@ -0,0 +1,202 @@
+#include "ResultWriter.hpp"
+
+using namespace std;
+
+ResultWriter::ResultWriter(const string &filename, bool bin, bool ord)
+    : file(fopen(filename.c_str(), "ab")), binary(bin), ordered(ord),
+      head(&stub), tail(&stub), closing(false), writerIdle(false),
+      bufferPos(0), nextSequence(0)
+{
+    if (!file)
+    {
+        return;
+    }
+
+    buffer.resize(BUFFER_SIZE);
+    writerThread = thread(&ResultWriter::run, this);
+}
+
+ResultWriter::~ResultWriter()
+{
+    close();
+}
+
+void ResultWriter::write(uint64_t sequence, uint32_t userId, const vector<Recommendation> &recommendations)
+{
+    if (!file)
+    {
+        return;
+    }
+
+    Record *record = new Record();
+    record->sequence = sequence;
+
+    const size_t count = min(recommendations.size(), static_cast<size_t>(Config::TOP_K));
+    char *ptr = record->data;
+    char *const end = record->data + RECORD_CAPACITY;
+
+    if (binary)
+    {
+        const uint32_t header[2] = {userId, static_cast<uint32_t>(count)};
+        memcpy(ptr, header, sizeof(header));
+        ptr += sizeof(header);
+        for (size_t i = 0; i < count; ++i)
+        {
+            memcpy(ptr, &recommendations[i].movieId, sizeof(uint32_t));
+            ptr += sizeof(uint32_t);
+        }
+    }
+    else
+    {
+        ptr = to_chars(ptr, end, userId).ptr;
+        for (size_t i = 0; i < count; ++i)
+        {
+            *ptr++ = ' ';
+            ptr = to_chars(ptr, end, recommendations[i].movieId).ptr;
+        }
+        *ptr++ = '\n';
+    }
+
+    record->length = static_cast<uint32_t>(ptr - record->data);
+    push(record);
+
+    if (writerIdle.load(memory_order_acquire))
+    {
+        lock_guard<mutex> lock(wakeMutex);
+        wakeCv.notify_one();
+    }
+}
+
+void ResultWriter::push(Record *record)
+{
+    record->next.store(nullptr, memory_order_relaxed);
+    Record *prev = head.exchange(record, memory_order_acq_rel);
+    prev->next.store(record, memory_order_release);
+}
+
+ResultWriter::Record *ResultWriter::pop()
+{
+    Record *current = tail;
+    Record *next = current->next.load(memory_order_acquire);
+
+    if (current == &stub)
+    {
+        if (!next)
+            return nullptr;
+        tail = next;
+        current = next;
+        next = next->next.load(memory_order_acquire);
+    }
+
+    if (next)
+    {
+        tail = next;
+        return current;
+    }
+
+    if (current != head.load(memory_order_acquire))
+        return nullptr;
+
+    push(&stub);
+    next = current->next.load(memory_order_acquire);
+    if (next)
+    {
+        tail = next;
+        return current;
+    }
+    return nullptr;
+}
+
+void ResultWriter::run()
+{
+    while (true)
+    {
+        Record *record = pop();
+        if (record)
+        {
+            emit(record);
+            continue;
+        }
+
+        if (closing.load(memory_order_acquire))
+        {
+            while ((record = pop()) != nullptr)
+                emit(record);
+            break;
+        }
+
+        unique_lock<mutex> lock(wakeMutex);
+        writerIdle.store(true, memory_order_release);
+        wakeCv.wait_for(lock, chrono::milliseconds(1));
+        writerIdle.store(false, memory_order_release);
+    }
+
+    for (auto &[sequence, record] : pending)
+    {
+        (void)sequence;
+        memcpy(buffer.data() + bufferPos, record->data, record->length);
+        bufferPos += record->length;
+        if (bufferPos + RECORD_CAPACITY > buffer.size())
+            flush();
+        delete record;
+    }
+    pending.clear();
+    flush();
+}
+
+void ResultWriter::emit(Record *record)
+{
+    if (ordered && record->sequence != nextSequence)
+    {
+        pending.emplace(record->sequence, record);
+        return;
+    }
+
+    while (record)
+    {
+        memcpy(buffer.data() + bufferPos, record->data, record->length);
+        bufferPos += record->length;
+        if (bufferPos + RECORD_CAPACITY > buffer.size())
+            flush();
+        delete record;
+        ++nextSequence;
+
+        record = nullptr;
+        if (ordered && !pending.empty() && pending.begin()->first == nextSequence)
+        {
+            record = pending.begin()->second;
+            pending.erase(pending.begin());
+        }
+    }
+}
+
+void ResultWriter::flush()
+{
+    if (bufferPos > 0)
+    {
+        fwrite(buffer.data(), 1, bufferPos, file);
+        bufferPos = 0;
+    }
+}
+
+void ResultWriter::close()
+{
+    if (!file)
+    {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(wakeMutex);
+        closing.store(true, memory_order_release);
+    }
+    wakeCv.notify_one();
+
+    if (writerThread.joinable())
+    {
+        writerThread.join();
+    }
+
+    fclose(file);
+    file = nullptr;
+}
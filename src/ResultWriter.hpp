@@ -0,0 +1,64 @@
+#ifndef RESULT_WRITER_HPP
+#define RESULT_WRITER_HPP
+
+#include "Config.hpp"
+#include "DataStructures.hpp"
+
+#include <condition_variable>
+#include <map>
+
+// Estágio de escrita das recomendações: as threads de trabalho formatam cada registro e o
+// publicam numa fila MPSC sem lock; uma thread dedicada agrupa os registros em blocos grandes.
+class ResultWriter
+{
+public:
+    ResultWriter(const std::string &filename, bool binary, bool ordered);
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter &) = delete;
+    ResultWriter &operator=(const ResultWriter &) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+
+    void write(uint64_t sequence, uint32_t userId, const std::vector<Recommendation> &recommendations);
+    void close();
+
+private:
+    static constexpr size_t RECORD_CAPACITY = 12 * (Config::TOP_K + 2);
+    static constexpr size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+    struct Record
+    {
+        std::atomic<Record *> next{nullptr};
+        uint64_t sequence = 0;
+        uint32_t length = 0;
+        char data[RECORD_CAPACITY];
+    };
+
+    FILE *file;
+    bool binary;
+    bool ordered;
+
+    Record stub;
+    std::atomic<Record *> head;
+    Record *tail;
+
+    std::thread writerThread;
+    std::atomic<bool> closing;
+    std::atomic<bool> writerIdle;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+
+    std::vector<char> buffer;
+    size_t bufferPos;
+    uint64_t nextSequence;
+    std::map<uint64_t, Record *> pending;
+
+    void push(Record *record);
+    Record *pop();
+    void run();
+    void emit(Record *record);
+    void flush();
+};
+
+#endif
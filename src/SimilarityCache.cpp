@@ -0,0 +1,146 @@
+#include "SimilarityCache.hpp"
+
+using namespace std;
+
+SimilarityCache::SimilarityCache(size_t maxBytes, size_t numShards)
+    : shardCount(max<size_t>(1, numShards))
+{
+    size_t numBuckets = 1;
+    while (numBuckets * 2 * sizeof(Bucket) <= maxBytes)
+    {
+        numBuckets *= 2;
+    }
+
+    buckets = make_unique<Bucket[]>(numBuckets);
+    shards = make_unique<Shard[]>(shardCount);
+    bucketMask = numBuckets - 1;
+    clear();
+}
+
+size_t SimilarityCache::bucketIndex(uint64_t key) const
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return static_cast<size_t>(key) & bucketMask;
+}
+
+bool SimilarityCache::find(uint64_t key, float &value) const
+{
+    const size_t index = bucketIndex(key);
+    const Bucket &bucket = buckets[index];
+    Shard &shard = shardFor(index);
+
+    const uint32_t seq = bucket.seq.load(memory_order_acquire);
+    if ((seq & 1) == 0)
+    {
+        for (int w = 0; w < WAYS; ++w)
+        {
+            if (bucket.keys[w].load(memory_order_relaxed) != key)
+                continue;
+
+            const uint32_t bits = bucket.values[w].load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+            if (bucket.seq.load(memory_order_relaxed) != seq)
+                break;
+
+            if (!bucket.referenced[w].load(memory_order_relaxed))
+                bucket.referenced[w].store(1, memory_order_relaxed);
+
+            memcpy(&value, &bits, sizeof(value));
+            shard.hits.fetch_add(1, memory_order_relaxed);
+            return true;
+        }
+    }
+
+    shard.misses.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+void SimilarityCache::insert(uint64_t key, float value)
+{
+    const size_t index = bucketIndex(key);
+    Bucket &bucket = buckets[index];
+    Shard &shard = shardFor(index);
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    lock_guard<mutex> lock(shard.mutex);
+
+    int victim = -1;
+    for (int w = 0; w < WAYS; ++w)
+    {
+        const uint64_t current = bucket.keys[w].load(memory_order_relaxed);
+        if (current == key)
+            return;
+        if (current == EMPTY_KEY && victim < 0)
+            victim = w;
+    }
+
+    if (victim < 0)
+    {
+        while (bucket.referenced[bucket.hand].load(memory_order_relaxed))
+        {
+            bucket.referenced[bucket.hand].store(0, memory_order_relaxed);
+            bucket.hand = (bucket.hand + 1) % WAYS;
+        }
+        victim = bucket.hand;
+        bucket.hand = (bucket.hand + 1) % WAYS;
+        shard.evictions.fetch_add(1, memory_order_relaxed);
+    }
+
+    const uint32_t seq = bucket.seq.load(memory_order_relaxed);
+    bucket.seq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    bucket.keys[victim].store(key, memory_order_relaxed);
+    bucket.values[victim].store(bits, memory_order_relaxed);
+    bucket.referenced[victim].store(0, memory_order_relaxed);
+    bucket.seq.store(seq + 2, memory_order_release);
+
+    shard.insertions.fetch_add(1, memory_order_relaxed);
+}
+
+void SimilarityCache::clear()
+{
+    for (size_t s = 0; s < shardCount; ++s)
+    {
+        shards[s].mutex.lock();
+    }
+
+    for (size_t b = 0; b <= bucketMask; ++b)
+    {
+        Bucket &bucket = buckets[b];
+        const uint32_t seq = bucket.seq.load(memory_order_relaxed);
+        bucket.seq.store(seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        for (int w = 0; w < WAYS; ++w)
+        {
+            bucket.keys[w].store(EMPTY_KEY, memory_order_relaxed);
+            bucket.values[w].store(0, memory_order_relaxed);
+            bucket.referenced[w].store(0, memory_order_relaxed);
+        }
+        bucket.hand = 0;
+        bucket.seq.store(seq + 2, memory_order_release);
+    }
+
+    for (size_t s = 0; s < shardCount; ++s)
+    {
+        shards[s].mutex.unlock();
+    }
+}
+
+SimilarityCacheStats SimilarityCache::stats() const
+{
+    SimilarityCacheStats result;
+    for (size_t s = 0; s < shardCount; ++s)
+    {
+        result.hits += shards[s].hits.load(memory_order_relaxed);
+        result.misses += shards[s].misses.load(memory_order_relaxed);
+        result.insertions += shards[s].insertions.load(memory_order_relaxed);
+        result.evictions += shards[s].evictions.load(memory_order_relaxed);
+    }
+    result.capacity = (bucketMask + 1) * WAYS;
+    result.bytes = (bucketMask + 1) * sizeof(Bucket) + shardCount * sizeof(Shard);
+    return result;
+}
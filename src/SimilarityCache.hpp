@@ -0,0 +1,62 @@
+#ifndef SIMILARITY_CACHE_HPP
+#define SIMILARITY_CACHE_HPP
+
+#include "Config.hpp"
+
+struct SimilarityCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    size_t capacity = 0;
+    size_t bytes = 0;
+};
+
+// Cache concorrente de similaridades, associativo por conjunto (WAYS entradas por bucket).
+// Leituras não usam lock (seqlock por bucket); escritas travam apenas o shard do bucket
+// e, com o bucket cheio, escolhem a vítima pela política CLOCK.
+class SimilarityCache
+{
+public:
+    explicit SimilarityCache(size_t maxBytes = Config::SIMILARITY_CACHE_MB * 1024 * 1024,
+                             size_t numShards = Config::SIMILARITY_CACHE_SHARDS);
+
+    bool find(uint64_t key, float &value) const;
+    void insert(uint64_t key, float value);
+    void clear();
+
+    SimilarityCacheStats stats() const;
+
+private:
+    static constexpr int WAYS = 8;
+    static constexpr uint64_t EMPTY_KEY = UINT64_MAX;
+
+    struct alignas(64) Bucket
+    {
+        std::atomic<uint32_t> seq{0};
+        uint8_t hand = 0;
+        mutable std::atomic<uint8_t> referenced[WAYS];
+        std::atomic<uint64_t> keys[WAYS];
+        std::atomic<uint32_t> values[WAYS];
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        mutable std::atomic<uint64_t> hits{0};
+        mutable std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> insertions{0};
+        std::atomic<uint64_t> evictions{0};
+    };
+
+    std::unique_ptr<Bucket[]> buckets;
+    std::unique_ptr<Shard[]> shards;
+    size_t bucketMask;
+    size_t shardCount;
+
+    size_t bucketIndex(uint64_t key) const;
+    Shard &shardFor(size_t bucket) const { return shards[bucket % shardCount]; }
+};
+
+#endif
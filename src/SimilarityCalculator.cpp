@@ -1,10 +1,16 @@
 #include "SimilarityCalculator.hpp"
+#include "Intersection.hpp"
 
 
 using namespace std;
 
-SimilarityCalculator::SimilarityCalculator(const unordered_map<uint32_t, UserProfile> &u)
-    : users(u) {}
+SimilarityCalculator::SimilarityCalculator(const RatingStore &s, Config::SimilarityMetric m)
+    : store(s), metric(m) {}
+
+RatingRow SimilarityCalculator::profile(uint32_t u, RowBuffer &buffer) const
+{
+    return centered() ? store.userCenteredRow(u, buffer) : store.userRow(u, buffer);
+}
 
 uint64_t SimilarityCalculator::makeKey(uint32_t user1, uint32_t user2) const
 {
@@ -13,70 +19,80 @@ uint64_t SimilarityCalculator::makeKey(uint32_t user1, uint32_t user2) const
 
 float SimilarityCalculator::calculateCosineSimilarity(uint32_t user1, uint32_t user2) const
 {
-    
-    uint64_t key = makeKey(user1, user2);
-    {
-        lock_guard<mutex> lock(cacheMutex);
-        auto it = cache.find(key);
-        if (it != cache.end())
-            return it->second;
-    }
+    if (user1 >= store.numUsers())
+        return 0.0f;
 
-    auto it1 = users.find(user1);
-    auto it2 = users.find(user2);
+    thread_local RowBuffer buffer1;
+    return calculateCosineSimilarity(user1, profile(user1, buffer1), user2);
+}
 
-    if (it1 == users.end() || it2 == users.end())
-        return 0.0f;
+float SimilarityCalculator::calculateCosineSimilarity(uint32_t user1, const RatingRow &row1, uint32_t user2) const
+{
+    float result;
+    if (shortcut(user1, row1.size, user2, result))
+        return result;
 
-    const auto &ratings1 = it1->second.ratings;
-    const auto &ratings2 = it2->second.ratings;
+    thread_local RowBuffer buffer2;
+    return cosine(user1, row1, user2, profile(user2, buffer2));
+}
 
-    if (ratings1.size() < Config::MIN_COMMON_ITEMS ||
-        ratings2.size() < Config::MIN_COMMON_ITEMS)
-    {
-        return 0.0f;
-    }
+float SimilarityCalculator::calculateCosineSimilarity(uint32_t user1, const RatingRow &row1,
+                                                      uint32_t user2, const RatingRow &row2) const
+{
+    float result;
+    if (shortcut(user1, row1.size, user2, result))
+        return result;
 
-    float dotProduct = 0.0f;
-    float normA = 0.0f, normB = 0.0f;
-    int commonItems = 0;
+    return cosine(user1, row1, user2, row2);
+}
 
-    size_t i = 0, j = 0;
-    while (i < ratings1.size() && j < ratings2.size())
+bool SimilarityCalculator::shortcut(uint32_t user1, size_t size1, uint32_t user2, float &result) const
+{
+    if (cache.find(makeKey(user1, user2), result))
+        return true;
+
+    result = 0.0f;
+    if (user1 >= store.numUsers() || user2 >= store.numUsers())
+        return true;
+
+    return size1 < Config::MIN_COMMON_ITEMS ||
+           store.userRowSize(user2) < Config::MIN_COMMON_ITEMS;
+}
+
+float SimilarityCalculator::cosine(uint32_t user1, const RatingRow &row1, uint32_t user2, const RatingRow &row2) const
+{
+    const vector<float> &norms = centered() ? store.userCenteredNorm : store.userNorm;
+    const float similarity = uncachedCosine(norms, user1, row1, user2, row2);
+
+    cache.insert(makeKey(user1, user2), similarity);
+
+    return similarity;
+}
+
+float SimilarityCalculator::uncachedCosine(const vector<float> &norms, uint32_t user1, const RatingRow &row1,
+                                           uint32_t user2, const RatingRow &row2)
+{
+    thread_local vector<uint32_t> positions1;
+    thread_local vector<uint32_t> positions2;
+    const size_t capacity = min(row1.size, row2.size);
+    if (positions1.size() < capacity)
     {
-        if (ratings1[i].first < ratings2[j].first)
-        {
-            i++;
-        }
-        else if (ratings1[i].first > ratings2[j].first)
-        {
-            j++;
-        }
-        else
-        {
-            float r1 = ratings1[i].second;
-            float r2 = ratings2[j].second;
-
-            dotProduct += r1 * r2;
-            normA += r1 * r1;
-            normB += r2 * r2;
-            commonItems++;
-
-            i++;
-            j++;
-        }
+        positions1.resize(capacity);
+        positions2.resize(capacity);
     }
 
+    const int commonItems = static_cast<int>(Intersection::positions(
+        row1.items, row1.size, row2.items, row2.size, positions1.data(), positions2.data()));
+
     if (commonItems < Config::MIN_COMMON_ITEMS)
         return 0.0f;
 
-    float denominator = sqrt(normA) * sqrt(normB);
-    float similarity = (denominator == 0.0f) ? 0.0f : dotProduct / denominator;
-
+    float dotProduct = 0.0f;
+    for (int k = 0; k < commonItems; ++k)
     {
-        lock_guard<mutex> lock(cacheMutex);
-        cache[key] = similarity;
+        dotProduct += row1.ratings[positions1[k]] * row2.ratings[positions2[k]];
     }
 
-    return similarity;
-}
\ No newline at end of file
+    float denominator = norms[user1] * norms[user2];
+    return (denominator == 0.0f) ? 0.0f : dotProduct / denominator;
+}
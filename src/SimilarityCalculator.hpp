@@ -2,22 +2,50 @@
 #define SIMILARITY_CALCULATOR_HPP
 
 #include "Config.hpp"
-#include "DataStructures.hpp"
+#include "RatingStore.hpp"
+#include "SimilarityCache.hpp"
 
 class SimilarityCalculator
 {
 private:
-    const std::unordered_map<uint32_t, UserProfile> &users;
-    mutable std::unordered_map<uint64_t, float> cache;
-    mutable std::mutex cacheMutex;
+    const RatingStore &store;
+    const Config::SimilarityMetric metric;
+    mutable SimilarityCache cache;
 
 public:
-    SimilarityCalculator(const std::unordered_map<uint32_t, UserProfile> &u);
+    SimilarityCalculator(const RatingStore &s, Config::SimilarityMetric m);
+
+    // Linha de u na representação da métrica: notas cruas (cosseno) ou centradas (ajustado).
+    // As sobrecargas que recebem linhas esperam linhas obtidas por aqui.
+    RatingRow profile(uint32_t u, RowBuffer &buffer) const;
+
+    bool centered() const { return metric == Config::SimilarityMetric::AdjustedCosine; }
 
     float calculateCosineSimilarity(uint32_t user1, uint32_t user2) const;
 
+    // Mesma similaridade, reaproveitando a linha já decodificada de user1.
+    float calculateCosineSimilarity(uint32_t user1, const RatingRow &row1, uint32_t user2) const;
+
+    // Com as duas linhas já decodificadas (blocos de candidatos do modo em lote).
+    float calculateCosineSimilarity(uint32_t user1, const RatingRow &row1,
+                                    uint32_t user2, const RatingRow &row2) const;
+
+    SimilarityCacheStats cacheStats() const { return cache.stats(); }
+
+    // Produto escalar esparso sobre norms (userNorm ou userCenteredNorm, conforme as linhas), sem
+    // cache e sem os atalhos de perfil curto. Usado também pelo kNN exato (UserNeighbors), para as
+    // similaridades baterem com as do LSH.
+    static float uncachedCosine(const std::vector<float> &norms, uint32_t user1, const RatingRow &row1,
+                                uint32_t user2, const RatingRow &row2);
+
 private:
     uint64_t makeKey(uint32_t user1, uint32_t user2) const;
+
+    // Resolve sem interseção (cache, índices inválidos, perfis curtos); false se precisa calcular.
+    bool shortcut(uint32_t user1, size_t size1, uint32_t user2, float &result) const;
+
+    // uncachedCosine com as normas da métrica, guardado no cache.
+    float cosine(uint32_t user1, const RatingRow &row1, uint32_t user2, const RatingRow &row2) const;
 };
 
 #endif 
\ No newline at end of file
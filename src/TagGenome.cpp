@@ -0,0 +1,300 @@
+#include "TagGenome.hpp"
+#include "ThreadPool.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAG_GENOME_X86 1
+#endif
+
+using namespace std;
+
+namespace
+{
+    inline const char *skipToNext(const char *p, const char *end)
+    {
+        while (p < end && *p != '\n' && *p != '\r')
+            ++p;
+        while (p < end && (*p == '\n' || *p == '\r'))
+            ++p;
+        return p;
+    }
+
+    // Uma linha "movieId,tagId,relevance"; o cabeçalho e linhas malformadas devolvem false.
+    inline bool parseLine(const char *&p, const char *end, uint32_t &movieId, uint32_t &tagId, float &value)
+    {
+        const char *q = p;
+        p = skipToNext(p, end);
+
+        auto [q1, ec1] = from_chars(q, end, movieId);
+        if (ec1 != errc{} || q1 >= end || *q1 != ',')
+            return false;
+        auto [q2, ec2] = from_chars(q1 + 1, end, tagId);
+        if (ec2 != errc{} || q2 >= end || *q2 != ',')
+            return false;
+        auto [q3, ec3] = from_chars(q2 + 1, end, value);
+        return ec3 == errc{} && tagId >= 1 && tagId <= static_cast<uint32_t>(Config::GENOME_MAX_TAGS);
+    }
+
+    // Divide o arquivo em um pedaço por thread, alinhado ao início das linhas: cada pedaço termina
+    // exatamente onde o seguinte começa, então a linha que cruza o corte fica inteira no anterior.
+    template <typename Body>
+    void forEachChunk(const char *data, size_t size, Body body)
+    {
+        ThreadPool &pool = ThreadPool::instance();
+        const size_t numChunks = min(pool.concurrency(), max<size_t>(1, size / 5000000));
+        const size_t chunkSize = size / numChunks;
+        const char *const dataEnd = data + size;
+
+        vector<const char *> bounds(numChunks + 1, dataEnd);
+        bounds[0] = data;
+        for (size_t t = 1; t < numChunks; ++t)
+        {
+            const char *start = max(data + t * chunkSize, bounds[t - 1]);
+            while (start < dataEnd && *(start - 1) != '\n')
+                ++start;
+            bounds[t] = start;
+        }
+
+        TaskGroup tasks(pool);
+        for (size_t t = 0; t < numChunks; ++t)
+        {
+            const char *chunkStart = bounds[t];
+            const char *chunkEnd = bounds[t + 1];
+            tasks.run([&body, t, chunkStart, chunkEnd]()
+                      { body(t, chunkStart, chunkEnd); });
+        }
+        tasks.wait();
+    }
+
+    int32_t scalarDot(const uint8_t *a, const int8_t *b, size_t n)
+    {
+        int32_t sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum += static_cast<int32_t>(a[i]) * b[i];
+        }
+        return sum;
+    }
+
+#ifdef TAG_GENOME_X86
+
+    // maddubs multiplica u8×s8 e soma pares em int16: com códigos até 127 e pesos em [-127, 127]
+    // cada par fica abaixo de 32767, sem saturação. madd com 1 leva os pares a int32.
+    __attribute__((target("avx2"))) int32_t avx2Dot(const uint8_t *a, const int8_t *b, size_t n)
+    {
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t i = 0; i < n; i += 32)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(x, y), ones));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+    }
+
+#endif
+
+    struct DotKernel
+    {
+        int32_t (*dot)(const uint8_t *, const int8_t *, size_t);
+        const char *name;
+    };
+
+    DotKernel selectKernel()
+    {
+#ifdef TAG_GENOME_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {avx2Dot, "avx2"};
+#endif
+        return {scalarDot, "scalar"};
+    }
+
+    const DotKernel kernel = selectKernel();
+}
+
+bool TagGenome::load(const string &filename, const RatingStore &store)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) == -1 || sb.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    const char *const data = static_cast<const char *>(
+        mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(const_cast<char *>(data), sb.st_size, MADV_SEQUENTIAL);
+
+    const size_t nm = store.numMovies();
+    const size_t numChunks = ThreadPool::instance().concurrency();
+
+    // Primeira passada: quais filmes da RatingStore aparecem e qual o maior tagId.
+    vector<vector<uint8_t>> seen(numChunks);
+    vector<uint32_t> maxTag(numChunks, 0);
+    forEachChunk(data, sb.st_size, [&](size_t t, const char *p, const char *end)
+                 {
+        seen[t].assign(nm, 0);
+        uint32_t movieId, tagId;
+        float value;
+        while (p < end) {
+            if (!parseLine(p, end, movieId, tagId, value))
+                continue;
+            const uint32_t movieIdx = store.movieIndex(movieId);
+            if (movieIdx == RatingStore::INVALID_INDEX)
+                continue;
+            seen[t][movieIdx] = 1;
+            maxTag[t] = max(maxTag[t], tagId);
+        } });
+
+    rowOf.assign(nm, -1);
+    int32_t rows = 0;
+    for (size_t m = 0; m < nm; ++m)
+    {
+        for (size_t t = 0; t < numChunks; ++t)
+        {
+            if (!seen[t].empty() && seen[t][m])
+            {
+                rowOf[m] = rows++;
+                break;
+            }
+        }
+    }
+    seen.clear();
+    tags = *max_element(maxTag.begin(), maxTag.end());
+    stride = (tags + 31) & ~size_t(31);
+
+    if (rows == 0 || tags == 0)
+    {
+        munmap(const_cast<char *>(data), sb.st_size);
+        rowOf.clear();
+        tags = stride = 0;
+        return false;
+    }
+
+    // Segunda passada: códigos de relevância direto na linha de cada filme.
+    relevance.assign(static_cast<size_t>(rows) * stride, 0);
+    forEachChunk(data, sb.st_size, [&](size_t, const char *p, const char *end)
+                 {
+        uint32_t movieId, tagId;
+        float value;
+        while (p < end) {
+            if (!parseLine(p, end, movieId, tagId, value))
+                continue;
+            const uint32_t movieIdx = store.movieIndex(movieId);
+            if (movieIdx == RatingStore::INVALID_INDEX)
+                continue;
+            const float clamped = min(1.0f, max(0.0f, value));
+            relevance[static_cast<size_t>(rowOf[movieIdx]) * stride + tagId - 1] =
+                static_cast<uint8_t>(lround(clamped * 127.0f));
+        } });
+    munmap(const_cast<char *>(data), sb.st_size);
+
+    vector<uint64_t> sums(stride, 0);
+    for (int32_t r = 0; r < rows; ++r)
+    {
+        const uint8_t *row = relevance.data() + static_cast<size_t>(r) * stride;
+        for (size_t t = 0; t < stride; ++t)
+        {
+            sums[t] += row[t];
+        }
+    }
+    tagMean.assign(stride, 0.0f);
+    for (size_t t = 0; t < tags; ++t)
+    {
+        tagMean[t] = static_cast<float>(sums[t]) / rows;
+    }
+
+    centeredNorm.assign(rows, 0.0f);
+    ThreadPool::instance().parallelFor(0, rows, 256, [&](size_t start, size_t end)
+                                       {
+        for (size_t r = start; r < end; ++r) {
+            const uint8_t *row = relevance.data() + r * stride;
+            float sum = 0.0f;
+            for (size_t t = 0; t < tags; ++t) {
+                const float deviation = row[t] - tagMean[t];
+                sum += deviation * deviation;
+            }
+            centeredNorm[r] = sqrt(sum);
+        } });
+
+    return true;
+}
+
+bool TagGenome::taste(const RatingRow &user, Taste &out) const
+{
+    vector<int32_t> sums(stride, 0);
+    int liked = 0;
+    for (size_t i = 0; i < user.size; ++i)
+    {
+        if (user.ratings[i] < Config::MIN_RATING || rowOf[user.items[i]] < 0)
+            continue;
+        const uint8_t *row = relevance.data() + static_cast<size_t>(rowOf[user.items[i]]) * stride;
+        for (size_t t = 0; t < stride; ++t)
+        {
+            sums[t] += row[t];
+        }
+        ++liked;
+    }
+    if (liked == 0)
+    {
+        return false;
+    }
+
+    vector<float> deviations(tags);
+    float maxDeviation = 0.0f;
+    for (size_t t = 0; t < tags; ++t)
+    {
+        deviations[t] = static_cast<float>(sums[t]) / liked - tagMean[t];
+        maxDeviation = max(maxDeviation, fabs(deviations[t]));
+    }
+    if (maxDeviation == 0.0f)
+    {
+        return false;
+    }
+
+    out.weights.assign(stride, 0);
+    out.offset = 0.0f;
+    float normSquared = 0.0f;
+    for (size_t t = 0; t < tags; ++t)
+    {
+        const int8_t weight = static_cast<int8_t>(lround(deviations[t] * 127.0f / maxDeviation));
+        out.weights[t] = weight;
+        out.offset += weight * tagMean[t];
+        normSquared += weight * weight;
+    }
+    out.norm = sqrt(normSquared);
+    return true;
+}
+
+float TagGenome::affinity(const Taste &taste, uint32_t movieIdx) const
+{
+    const int32_t r = rowOf[movieIdx];
+    if (r < 0 || taste.norm == 0.0f || centeredNorm[r] == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    const int32_t dot = kernel.dot(relevance.data() + static_cast<size_t>(r) * stride, taste.weights.data(), stride);
+    return (dot - taste.offset) / (taste.norm * centeredNorm[r]);
+}
+
+const char *TagGenome::kernelName()
+{
+    return kernel.name;
+}
@@ -0,0 +1,49 @@
+#ifndef TAG_GENOME_HPP
+#define TAG_GENOME_HPP
+
+#include "Config.hpp"
+#include "RatingStore.hpp"
+
+// Tag Genome do MovieLens (genome-scores.csv): relevância de cada tag para cada filme, quantizada
+// em códigos de 0 a 127 numa matriz densa filme×tag. O gosto do usuário é a média dos vetores dos
+// filmes bem avaliados menos a média do catálogo, quantizada em int8; a afinidade com um filme é o
+// cosseno entre esse gosto e o vetor centrado do filme. O produto interno u8×s8 usa AVX2
+// (maddubs) ou escalar, escolhido em tempo de execução.
+class TagGenome
+{
+public:
+    struct Taste
+    {
+        std::vector<int8_t> weights; // stride posições, zeros no preenchimento
+        float offset = 0.0f;         // soma de weights[t] * tagMean[t], descontada do produto cru
+        float norm = 0.0f;
+    };
+
+    // Falha se o arquivo não existir ou não tiver nenhum filme da RatingStore.
+    bool load(const std::string &filename, const RatingStore &store);
+
+    bool empty() const { return relevance.empty(); }
+
+    bool hasMovie(uint32_t movieIdx) const { return rowOf[movieIdx] >= 0; }
+
+    size_t numMovies() const { return centeredNorm.size(); }
+    size_t numTags() const { return tags; }
+
+    // Só os filmes com nota >= Config::MIN_RATING entram; falha se nenhum tiver vetor de tags.
+    bool taste(const RatingRow &user, Taste &out) const;
+
+    // Cosseno em [-1, 1]; 0 para filmes sem vetor de tags.
+    float affinity(const Taste &taste, uint32_t movieIdx) const;
+
+    static const char *kernelName();
+
+private:
+    size_t tags = 0;
+    size_t stride = 0; // tags arredondado para múltiplo de 32 (um registro AVX2)
+    std::vector<int32_t> rowOf;
+    std::vector<uint8_t> relevance;
+    std::vector<float> tagMean;
+    std::vector<float> centeredNorm;
+};
+
+#endif
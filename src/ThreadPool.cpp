@@ -0,0 +1,266 @@
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+namespace
+{
+    struct WorkerContext
+    {
+        const ThreadPool *pool = nullptr;
+        size_t queue = 0;
+        const TaskGroup *waiting = nullptr; // grupo do wait() mais interno
+        const TaskGroup *running = nullptr; // grupo da tarefa em execução
+        bool inForeign = false;
+        double foreignSeconds = 0.0;
+    };
+
+    thread_local WorkerContext currentWorker;
+}
+
+TaskGroup::TaskGroup(ThreadPool &p) : pool(p), parent(currentWorker.running), pending(0) {}
+
+TaskGroup::~TaskGroup()
+{
+    while (pending.load(memory_order_acquire) > 0)
+    {
+        if (!pool.tryRunOne(pool.currentQueue(), this))
+            this_thread::yield();
+    }
+}
+
+bool TaskGroup::nestedIn(const TaskGroup *ancestor) const
+{
+    for (const TaskGroup *group = this; group; group = group->parent)
+    {
+        if (group == ancestor)
+            return true;
+    }
+    return false;
+}
+
+void TaskGroup::run(function<void()> task)
+{
+    pending.fetch_add(1, memory_order_relaxed);
+    pool.push({move(task), this});
+}
+
+void TaskGroup::wait()
+{
+    const TaskGroup *outer = currentWorker.waiting;
+    currentWorker.waiting = this;
+    while (pending.load(memory_order_acquire) > 0)
+    {
+        if (!pool.tryRunOne(pool.currentQueue(), this))
+            this_thread::yield();
+    }
+    currentWorker.waiting = outer;
+
+    lock_guard<mutex> lock(errorMutex);
+    if (error)
+    {
+        exception_ptr e = error;
+        error = nullptr;
+        rethrow_exception(e);
+    }
+}
+
+ThreadPool &ThreadPool::instance()
+{
+    static ThreadPool pool(Config::NUM_THREADS);
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t concurrency)
+    : queuedTasks(0), nextQueue(0), stopping(false)
+{
+    const size_t numWorkers = max<size_t>(1, concurrency) - 1;
+
+    queues.reserve(numWorkers + 1);
+    for (size_t i = 0; i <= numWorkers; ++i)
+    {
+        queues.push_back(make_unique<Queue>());
+    }
+
+    workers.reserve(numWorkers);
+    for (size_t i = 0; i < numWorkers; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stopping.store(true);
+    }
+    sleepCv.notify_all();
+
+    for (auto &worker : workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+size_t ThreadPool::currentQueue() const
+{
+    return currentWorker.pool == this ? currentWorker.queue : workers.size();
+}
+
+void ThreadPool::push(Task task)
+{
+    Queue &queue = *queues[currentQueue()];
+    {
+        lock_guard<mutex> lock(queue.mutex);
+        queue.tasks.push_back(move(task));
+    }
+    queuedTasks.fetch_add(1, memory_order_release);
+
+    {
+        lock_guard<mutex> lock(sleepMutex);
+    }
+    sleepCv.notify_one();
+}
+
+bool ThreadPool::eligible(const Task &task, const TaskGroup *waiting)
+{
+    return !waiting || task.group->nestedIn(waiting);
+}
+
+// Da mais recente para a mais antiga; numa espera, pula as tarefas fora do grupo esperado.
+bool ThreadPool::popLocal(size_t self, Task &task, const TaskGroup *waiting)
+{
+    Queue &queue = *queues[self];
+    lock_guard<mutex> lock(queue.mutex);
+    for (auto it = queue.tasks.rbegin(); it != queue.tasks.rend(); ++it)
+    {
+        if (eligible(*it, waiting))
+        {
+            task = move(*it);
+            queue.tasks.erase(next(it).base());
+            queuedTasks.fetch_sub(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::steal(size_t self, Task &task, const TaskGroup *waiting)
+{
+    const size_t numQueues = queues.size();
+    const size_t start = nextQueue.fetch_add(1, memory_order_relaxed);
+
+    for (size_t k = 0; k < numQueues; ++k)
+    {
+        const size_t victim = (start + k) % numQueues;
+        if (victim == self)
+            continue;
+
+        Queue &queue = *queues[victim];
+        lock_guard<mutex> lock(queue.mutex);
+        for (auto it = queue.tasks.begin(); it != queue.tasks.end(); ++it)
+        {
+            if (eligible(*it, waiting))
+            {
+                task = move(*it);
+                queue.tasks.erase(it);
+                queuedTasks.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+double ThreadPool::foreignSeconds()
+{
+    return currentWorker.foreignSeconds;
+}
+
+void ThreadPool::execute(Task &task)
+{
+    // Tarefa fora do grupo esperado executada durante uma espera: conta uma vez, mesmo se ela
+    // esperar também.
+    const bool foreign = currentWorker.waiting && !task.group->nestedIn(currentWorker.waiting) &&
+                         !currentWorker.inForeign;
+    const auto start = foreign ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+    currentWorker.inForeign |= foreign;
+    const TaskGroup *outer = currentWorker.running;
+    currentWorker.running = task.group;
+
+    try
+    {
+        task.fn();
+    }
+    catch (...)
+    {
+        lock_guard<mutex> lock(task.group->errorMutex);
+        if (!task.group->error)
+            task.group->error = current_exception();
+    }
+
+    currentWorker.running = outer;
+    if (foreign)
+    {
+        currentWorker.inForeign = false;
+        currentWorker.foreignSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    task.group->pending.fetch_sub(1, memory_order_release);
+}
+
+bool ThreadPool::tryRunOne(size_t self, const TaskGroup *waiting)
+{
+    if (queuedTasks.load(memory_order_acquire) == 0)
+        return false;
+
+    Task task;
+    if (popLocal(self, task, waiting) || steal(self, task, waiting))
+    {
+        execute(task);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+    currentWorker.pool = this;
+    currentWorker.queue = index;
+
+    while (true)
+    {
+        if (tryRunOne(index, nullptr))
+            continue;
+
+        unique_lock<mutex> lock(sleepMutex);
+        sleepCv.wait(lock, [this]()
+                     { return stopping.load() || queuedTasks.load(memory_order_acquire) > 0; });
+        if (stopping.load() && queuedTasks.load(memory_order_acquire) == 0)
+            return;
+    }
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain,
+                             const function<void(size_t, size_t)> &body)
+{
+    if (end <= begin)
+        return;
+
+    grain = max<size_t>(1, grain);
+    if (end - begin <= grain || workers.empty())
+    {
+        body(begin, end);
+        return;
+    }
+
+    TaskGroup group(*this);
+    for (size_t lo = begin + grain; lo < end; lo += grain)
+    {
+        const size_t hi = min(lo + grain, end);
+        group.run([&body, lo, hi]()
+                  { body(lo, hi); });
+    }
+    body(begin, min(begin + grain, end));
+    group.wait();
+}
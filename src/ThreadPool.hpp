@@ -0,0 +1,96 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "Config.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+class ThreadPool;
+
+// Conjunto de tarefas aguardadas em conjunto. wait() executa tarefas pendentes do grupo (ou de
+// grupos criados dentro das tarefas dele) enquanto espera, o que permite paralelismo aninhado sem
+// criar threads extras e sem prender a espera em trabalho alheio.
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool &pool);
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    void run(std::function<void()> task);
+    void wait();
+
+private:
+    friend class ThreadPool;
+
+    ThreadPool &pool;
+    const TaskGroup *parent; // grupo da tarefa em que este foi criado (nullptr fora do pool)
+    std::atomic<size_t> pending;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    // Se o grupo é ancestor ou descende dele pela cadeia de parent.
+    bool nestedIn(const TaskGroup *ancestor) const;
+};
+
+class ThreadPool
+{
+public:
+    static ThreadPool &instance();
+
+    explicit ThreadPool(size_t concurrency);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t concurrency() const { return workers.size() + 1; }
+
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)> &body);
+
+    // Segundos que a thread atual passou, dentro de TaskGroup::wait, executando tarefas fora da
+    // árvore do grupo esperado. A diferença entre duas leituras desconta do tempo de parede o
+    // trabalho alheio; como wait() só executa tarefas da árvore, ela fica em zero.
+    static double foreignSeconds();
+
+private:
+    friend class TaskGroup;
+
+    struct Task
+    {
+        std::function<void()> fn;
+        TaskGroup *group;
+    };
+
+    struct alignas(64) Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<size_t> queuedTasks;
+    std::atomic<size_t> nextQueue;
+    std::atomic<bool> stopping;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+
+    // waiting: só tarefas aninhadas nesse grupo (nullptr: qualquer uma).
+    static bool eligible(const Task &task, const TaskGroup *waiting);
+
+    void push(Task task);
+    bool tryRunOne(size_t self, const TaskGroup *waiting);
+    bool popLocal(size_t self, Task &task, const TaskGroup *waiting);
+    bool steal(size_t self, Task &task, const TaskGroup *waiting);
+    void execute(Task &task);
+    void workerLoop(size_t index);
+    size_t currentQueue() const;
+};
+
+#endif
@@ -0,0 +1,308 @@
+#include "UserNeighbors.hpp"
+#include "NeighborsFile.hpp"
+#include "SimilarityCalculator.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+namespace
+{
+    const char NEIGHBORS_MAGIC[8] = {'M', 'R', 'U', 'S', 'E', 'R', 'N', 'B'};
+    const uint32_t NEIGHBORS_VERSION = 2;
+
+    struct TableParams
+    {
+        uint64_t numUsers;
+        uint64_t numRatings;
+        uint64_t numQueries;
+        uint32_t neighborsPerUser;
+        uint32_t minCommonItems;
+        float minSimilarity;
+        uint32_t metric;
+    };
+
+    TableParams tableParams(const RatingStore &store, Config::SimilarityMetric metric, size_t numQueries,
+                            size_t neighborsPerUser)
+    {
+        TableParams params{};
+        params.numUsers = store.numUsers();
+        params.numRatings = store.numRatings();
+        params.numQueries = numQueries;
+        params.neighborsPerUser = static_cast<uint32_t>(neighborsPerUser);
+        params.minCommonItems = Config::MIN_COMMON_ITEMS;
+        params.minSimilarity = Config::MIN_SIMILARITY;
+        params.metric = static_cast<uint32_t>(metric);
+        return params;
+    }
+
+    // Índices válidos, ordenados e sem repetição.
+    vector<uint32_t> queryUsers(vector<uint32_t> userIdxs)
+    {
+        userIdxs.erase(remove(userIdxs.begin(), userIdxs.end(), RatingStore::INVALID_INDEX), userIdxs.end());
+        sort(userIdxs.begin(), userIdxs.end());
+        userIdxs.erase(unique(userIdxs.begin(), userIdxs.end()), userIdxs.end());
+        return userIdxs;
+    }
+
+    // Folga nos limites superiores, que somam em outra ordem que a similaridade verificada.
+    const float BOUND_SLACK = 1e-4f;
+
+    using Neighbor = UserNeighbors::Neighbor;
+
+    // Maior similaridade primeiro; empates pelo menor índice.
+    inline bool better(const Neighbor &a, const Neighbor &b)
+    {
+        return a.similarity != b.similarity ? a.similarity > b.similarity : a.user < b.user;
+    }
+
+    // Top-N exato de um usuário contra todos. As colunas dos filmes do usuário são lidas dos mais
+    // raros para os mais populares, acumulando o produto parcial de cada candidato. Um candidato que
+    // aparece só a partir da posição p tem similaridade <= |u[p:]| / |u| (Cauchy-Schwarz), então novos
+    // candidatos deixam de entrar quando esse limite cai abaixo do N-ésimo melhor já verificado (o
+    // filtro de prefixo) ou quando restam menos de MIN_COMMON_ITEMS filmes. Os admitidos são
+    // verificados em ordem decrescente do limite (parcial + |u[p:]| * |v fora do prefixo|) até ele
+    // ficar abaixo do limiar.
+    class Join
+    {
+    public:
+        Join(const RatingStore &s, bool c, size_t l)
+            : store(s), centered(c), norms(c ? s.userCenteredNorm : s.userNorm), limit(l) {}
+
+        // Devolve quantas similaridades foram verificadas.
+        uint64_t run(uint32_t u, vector<Neighbor> &result);
+
+    private:
+        const RatingStore &store;
+        const bool centered;
+        const vector<float> &norms;
+        const size_t limit;
+
+        // Por thread; state: 0 fora, 1 admitido, 2 verificado.
+        struct Scratch
+        {
+            vector<float> dots;
+            vector<float> squares; // soma dos quadrados das notas do candidato nos filmes já lidos
+            vector<uint8_t> state;
+            vector<uint32_t> touched;
+            RowBuffer candidateBuffer;
+        };
+
+        float verify(const RatingRow &row, uint32_t u, uint32_t v, Scratch &scratch) const;
+    };
+
+    float Join::verify(const RatingRow &row, uint32_t u, uint32_t v, Scratch &scratch) const
+    {
+        if (store.userRowSize(v) < static_cast<size_t>(Config::MIN_COMMON_ITEMS))
+            return 0.0f;
+
+        const RatingRow other = centered ? store.userCenteredRow(v, scratch.candidateBuffer)
+                                         : store.userRow(v, scratch.candidateBuffer);
+        return SimilarityCalculator::uncachedCosine(norms, u, row, v, other);
+    }
+
+    uint64_t Join::run(uint32_t u, vector<Neighbor> &result)
+    {
+        result.clear();
+
+        RowBuffer rowBuffer;
+        const RatingRow row = centered ? store.userCenteredRow(u, rowBuffer) : store.userRow(u, rowBuffer);
+        const float normU = norms[u];
+        if (row.size < static_cast<size_t>(Config::MIN_COMMON_ITEMS) || normU == 0.0f)
+            return 0;
+
+        thread_local Scratch scratch;
+        const size_t numUsers = store.numUsers();
+        if (scratch.state.size() != numUsers)
+        {
+            scratch.dots.assign(numUsers, 0.0f);
+            scratch.squares.assign(numUsers, 0.0f);
+            scratch.state.assign(numUsers, 0);
+        }
+
+        // Filmes mais raros primeiro: as colunas longas ficam no sufixo que o filtro corta.
+        const size_t n = row.size;
+        vector<uint32_t> order(n);
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+             {
+                 const size_t la = store.movieLists.length(row.items[a]);
+                 const size_t lb = store.movieLists.length(row.items[b]);
+                 return la != lb ? la < lb : a < b; });
+
+        vector<double> suffix(n + 1, 0.0);
+        for (size_t p = n; p-- > 0;)
+        {
+            const double value = row.ratings[order[p]];
+            suffix[p] = suffix[p + 1] + value * value;
+        }
+
+        // Heap com o pior dos melhores no topo.
+        uint64_t verified = 0;
+        auto threshold = [&]()
+        { return result.size() == limit ? result.front().similarity : Config::MIN_SIMILARITY; };
+        auto check = [&](uint32_t v)
+        {
+            scratch.state[v] = 2;
+            ++verified;
+            const Neighbor candidate{v, verify(row, u, v, scratch)};
+            if (candidate.similarity <= Config::MIN_SIMILARITY)
+                return;
+            if (result.size() < limit)
+            {
+                result.push_back(candidate);
+                push_heap(result.begin(), result.end(), better);
+            }
+            else if (better(candidate, result.front()))
+            {
+                pop_heap(result.begin(), result.end(), better);
+                result.back() = candidate;
+                push_heap(result.begin(), result.end(), better);
+            }
+        };
+
+        // Verifica os admitidos de maior produto parcial normalizado, para subir o limiar cedo.
+        vector<pair<float, uint32_t>> ranked;
+        auto refresh = [&]()
+        {
+            ranked.clear();
+            for (const uint32_t v : scratch.touched)
+            {
+                if (scratch.state[v] == 1 && norms[v] > 0.0f)
+                    ranked.push_back({scratch.dots[v] / norms[v], v});
+            }
+            const size_t take = min(limit, ranked.size());
+            nth_element(ranked.begin(), ranked.begin() + take, ranked.end(), greater<pair<float, uint32_t>>());
+            for (size_t k = 0; k < take; ++k)
+                check(ranked[k].second);
+        };
+
+        RowBuffer columnBuffer;
+        size_t p = 0;
+        size_t nextRefresh = 2 * limit;
+        while (p < n && n - p >= static_cast<size_t>(Config::MIN_COMMON_ITEMS) &&
+               static_cast<float>(sqrt(suffix[p])) / normU >= threshold() - BOUND_SLACK)
+        {
+            const float value = row.ratings[order[p]];
+            const RatingRow column = store.movieColumn(row.items[order[p]], columnBuffer);
+            for (size_t j = 0; j < column.size; ++j)
+            {
+                const uint32_t v = column.items[j];
+                if (v == u)
+                    continue;
+                if (scratch.state[v] == 0)
+                {
+                    scratch.state[v] = 1;
+                    scratch.dots[v] = 0.0f;
+                    scratch.squares[v] = 0.0f;
+                    scratch.touched.push_back(v);
+                }
+                const float other = centered ? column.ratings[j] - store.userAvgRating[v] : column.ratings[j];
+                scratch.dots[v] += value * other;
+                scratch.squares[v] += other * other;
+            }
+            ++p;
+
+            if (scratch.touched.size() >= nextRefresh)
+            {
+                refresh();
+                nextRefresh *= 2;
+            }
+        }
+
+        const float rest = static_cast<float>(sqrt(suffix[p]));
+        ranked.clear();
+        for (const uint32_t v : scratch.touched)
+        {
+            const float normV = norms[v];
+            if (scratch.state[v] != 1 || normV == 0.0f)
+                continue;
+            const float outside = sqrt(max(0.0f, normV * normV - scratch.squares[v]));
+            ranked.push_back({(scratch.dots[v] + rest * outside) / (normU * normV), v});
+        }
+        sort(ranked.begin(), ranked.end(), greater<pair<float, uint32_t>>());
+        for (const auto &[bound, v] : ranked)
+        {
+            if (bound < threshold() - BOUND_SLACK)
+                break;
+            check(v);
+        }
+
+        for (const uint32_t v : scratch.touched)
+            scratch.state[v] = 0;
+        scratch.touched.clear();
+
+        sort_heap(result.begin(), result.end(), better);
+        return verified;
+    }
+}
+
+void UserNeighbors::build(const RatingStore &store, vector<uint32_t> userIdxs, Config::SimilarityMetric metric,
+                          size_t neighborsPerUser)
+{
+    users = queryUsers(move(userIdxs));
+    limit = neighborsPerUser;
+
+    Join join(store, metric == Config::SimilarityMetric::AdjustedCosine, limit);
+    vector<vector<Neighbor>> rows(users.size());
+    vector<uint64_t> verifiedPerUser(users.size(), 0);
+    // Blocos pequenos: o custo por usuário varia muito com o perfil.
+    ThreadPool::instance().parallelFor(0, users.size(), 4, [&](size_t start, size_t end)
+                                       {
+        for (size_t i = start; i < end; ++i)
+            verifiedPerUser[i] = join.run(users[i], rows[i]); });
+
+    offsets.assign(users.size() + 1, 0);
+    for (size_t i = 0; i < users.size(); ++i)
+    {
+        offsets[i + 1] = offsets[i] + rows[i].size();
+    }
+    entries.resize(offsets.back());
+    verified = 0;
+    for (size_t i = 0; i < users.size(); ++i)
+    {
+        copy(rows[i].begin(), rows[i].end(), entries.begin() + offsets[i]);
+        verified += verifiedPerUser[i];
+    }
+}
+
+bool UserNeighbors::load(const string &filename, const RatingStore &store, vector<uint32_t> userIdxs,
+                         Config::SimilarityMetric metric, size_t neighborsPerUser)
+{
+    userIdxs = queryUsers(move(userIdxs));
+    limit = neighborsPerUser;
+
+    const bool ok = NeighborsFile::load(filename, NEIGHBORS_MAGIC, NEIGHBORS_VERSION,
+                                        tableParams(store, metric, userIdxs.size(), limit),
+                                        [&](NeighborsFile::Reader &in, uint64_t numEntries)
+                                        {
+        if (!in.fits<Neighbor>(numEntries))
+            return false;
+        users.resize(userIdxs.size());
+        offsets.resize(userIdxs.size() + 1);
+        entries.resize(numEntries);
+        return in.read(users) && in.read(offsets) && in.read(entries) && users == userIdxs &&
+               NeighborsFile::validOffsets(offsets, numEntries) &&
+               all_of(entries.begin(), entries.end(), [&](const Neighbor &neighbor)
+                      { return neighbor.user < store.numUsers(); }); });
+
+    if (!ok)
+    {
+        users.clear();
+        offsets.clear();
+        entries.clear();
+    }
+    verified = 0;
+    return ok;
+}
+
+bool UserNeighbors::save(const string &filename, const RatingStore &store, Config::SimilarityMetric metric) const
+{
+    if (empty())
+    {
+        return false;
+    }
+
+    return NeighborsFile::save(filename, NEIGHBORS_MAGIC, NEIGHBORS_VERSION, tableParams(store, metric, users.size(), limit),
+                               entries.size(), [this](NeighborsFile::Writer &out)
+                               { return out.write(users) && out.write(offsets) && out.write(entries); });
+}
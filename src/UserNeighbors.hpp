@@ -0,0 +1,59 @@
+#ifndef USER_NEIGHBORS_HPP
+#define USER_NEIGHBORS_HPP
+
+#include "Config.hpp"
+#include "RatingStore.hpp"
+
+// kNN exato dos usuários a recomendar (--exact-neighbors): para cada um, os neighborsPerUser
+// usuários de maior similaridade (a mesma de SimilarityCalculator) acima de Config::MIN_SIMILARITY,
+// em CSR e ordenados por similaridade decrescente. Substitui o LSH e o cálculo das similaridades
+// por usuário; persistido em Config::USER_NEIGHBORS_FILE. A avaliação (Evaluation) usa a mesma
+// construção para os vizinhos exatos do recall.
+class UserNeighbors
+{
+public:
+    struct Neighbor
+    {
+        uint32_t user;
+        float similarity;
+    };
+
+    struct Row
+    {
+        const Neighbor *items;
+        size_t size;
+    };
+
+    bool empty() const { return users.empty(); }
+
+    bool contains(uint32_t userIdx) const { return std::binary_search(users.begin(), users.end(), userIdx); }
+
+    // O usuário precisa estar na tabela (contains).
+    Row neighbors(uint32_t userIdx) const
+    {
+        const size_t i = std::lower_bound(users.begin(), users.end(), userIdx) - users.begin();
+        return {entries.data() + offsets[i], offsets[i + 1] - offsets[i]};
+    }
+
+    // userIdxs são índices densos; a RatingStore precisa das colunas (buildTranspose).
+    void build(const RatingStore &store, std::vector<uint32_t> userIdxs, Config::SimilarityMetric metric,
+               size_t neighborsPerUser = Config::MAX_SIMILAR_USERS);
+
+    // Falha se o arquivo não existir, estiver desatualizado, tiver outros parâmetros ou outros usuários.
+    bool load(const std::string &filename, const RatingStore &store, std::vector<uint32_t> userIdxs,
+              Config::SimilarityMetric metric, size_t neighborsPerUser = Config::MAX_SIMILAR_USERS);
+
+    bool save(const std::string &filename, const RatingStore &store, Config::SimilarityMetric metric) const;
+
+    // Similaridades exatas calculadas na última construção (as demais foram podadas pelos limites).
+    uint64_t verifiedPairs() const { return verified; }
+
+private:
+    std::vector<uint32_t> users; // índices densos, ordenados
+    std::vector<uint64_t> offsets;
+    std::vector<Neighbor> entries;
+    size_t limit = Config::MAX_SIMILAR_USERS;
+    uint64_t verified = 0;
+};
+
+#endif
@@ -1,5 +1,12 @@
 #include "preProcessament.hpp"
+#include "CsvScanner.hpp"
+#include "ThreadPool.hpp"
 
+namespace
+{
+    const size_t MIN_CHUNK_BYTES = 8 * 1024 * 1024; // Tamanho mínimo de cada chunk do ratings.csv.
+    const size_t RELEASE_STEP = 32 * 1024 * 1024;   // Intervalo para liberar páginas já lidas do mmap.
+}
 
 inline bool is_digit(char c)
 {
@@ -65,56 +72,72 @@ inline void safe_advance_to_next_line(char *&p, char *end)
         p++;
 }
 
-void process_chunk(DataChunk *chunk)
+// Devolve ao sistema as páginas já lidas do mmap, para que o RSS não cresça com o arquivo.
+inline void release_consumed(char *&released, const char *p)
 {
-    char *current_pos = chunk->start;
-    char *end_pos = chunk->end;
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    char *from = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(released) + page - 1) & ~(page - 1));
+    char *to = reinterpret_cast<char *>(reinterpret_cast<uintptr_t>(p) & ~(page - 1));
+    if (to > from && static_cast<size_t>(to - from) >= RELEASE_STEP)
+    {
+        madvise(from, to - from, MADV_DONTNEED);
+        released = to;
+    }
+}
 
-    while (current_pos < end_pos && *current_pos != '\n')
-        current_pos++;
-    if (current_pos < end_pos)
-        current_pos++;
+// Início da primeira linha em p ou depois dele cujo usuário é diferente do usuário da linha
+// que contém p; como o ratings.csv é ordenado por usuário, nenhum usuário fica dividido.
+char *align_to_user_boundary(char *p, char *begin, char *end)
+{
+    if (p <= begin)
+        return begin;
+    if (p >= end)
+        return end;
 
-    chunk->local_user_data.reserve(50000);
-    chunk->local_movie_count.reserve(60000);
+    while (p > begin && *(p - 1) != '\n')
+        p--;
 
-    while (current_pos < end_pos)
+    char *line = p;
+    const int userId = safe_fast_stoi(line, end);
+    while (p < end)
     {
-        int userId = safe_fast_stoi(current_pos, end_pos);
-        if (current_pos >= end_pos || *current_pos != ',')
-        {
-            safe_advance_to_next_line(current_pos, end_pos);
-            continue;
-        }
-        current_pos++;
-
-        int movieId = safe_fast_stoi(current_pos, end_pos);
-        if (current_pos >= end_pos || *current_pos != ',')
-        {
-            safe_advance_to_next_line(current_pos, end_pos);
-            continue;
-        }
-        current_pos++;
+        char *next = p;
+        if (safe_fast_stoi(next, end) != userId)
+            break;
+        safe_advance_to_next_line(p, end);
+    }
+    return p;
+}
 
-        float rating = safe_fast_stof(current_pos, end_pos);
-        safe_advance_to_next_line(current_pos, end_pos);
+void count_movies_chunk(const DataChunk *chunk, std::vector<uint32_t> *movie_count)
+{
+    RatingsCsvScanner scanner(chunk->start, chunk->end);
+    char *released = chunk->start;
+    int userId, movieId;
+    float rating;
 
-        if (userId > 0 && movieId > 0 && rating >= 0.0f && rating <= 5.0f)
-        {
-            chunk->local_user_data[userId].emplace_back(movieId, rating);
-            chunk->local_movie_count[movieId]++;
-        }
+    while (scanner.next(userId, movieId, rating))
+    {
+        if (movie_count->size() <= static_cast<size_t>(movieId))
+            movie_count->resize(std::max<size_t>(movieId + 1, movie_count->size() * 2), 0);
+        (*movie_count)[movieId]++;
+        release_consumed(released, scanner.position());
     }
 }
 
-void filter_and_write_chunk(const DataChunk *chunk, const std::unordered_set<int> *valid_movies, int thread_id)
+void filter_and_write_chunk(const DataChunk *chunk, const std::vector<uint8_t> *valid_movies, int chunk_id,
+                            RatingBatch *batch, bool write_file)
 {
-    std::string temp_filename = "datasets/input.dat.tmp." + std::to_string(thread_id);
-    FILE *output_file = fopen(temp_filename.c_str(), "w");
-    if (!output_file) { return; }
+    FILE *output_file = nullptr;
+    if (write_file)
+    {
+        std::string temp_filename = "datasets/input.dat.tmp." + std::to_string(chunk_id);
+        output_file = fopen(temp_filename.c_str(), "w");
+        if (!output_file) { return; }
+    }
 
     const size_t BUFFER_SIZE = 4 * 1024 * 1024;
-    std::vector<char> write_buffer(BUFFER_SIZE);
+    std::vector<char> write_buffer(write_file ? BUFFER_SIZE : 0);
     size_t buffer_pos = 0;
 
     auto flush_buffer = [&]()
@@ -132,63 +155,87 @@ void filter_and_write_chunk(const DataChunk *chunk, const std::unordered_set<int
         {
             flush_buffer();
         }
+        if (len >= BUFFER_SIZE)
+        {
+            fwrite(data, 1, len, output_file);
+            return;
+        }
         memcpy(write_buffer.data() + buffer_pos, data, len);
         buffer_pos += len;
     };
 
-    char line_buffer[16384];
+    std::vector<char> line_buffer;
     std::vector<Rating> valid_ratings_for_user;
     valid_ratings_for_user.reserve(200);
 
-    for (const auto &user_pair : chunk->local_user_data)
+    auto flush_user = [&](int userId)
     {
-        const auto &all_ratings = user_pair.second;
+        if (valid_ratings_for_user.size() < 50)
+        {
+            valid_ratings_for_user.clear();
+            return;
+        }
 
-        valid_ratings_for_user.clear();
-        for (const auto &rating : all_ratings)
+        if (batch)
         {
-            if (valid_movies->count(rating.movieId))
+            for (const auto &rating : valid_ratings_for_user)
             {
-                valid_ratings_for_user.push_back(rating);
+                batch->addRating(rating.movieId, rating.rating);
             }
+            batch->endLine(userId);
         }
 
-        if (valid_ratings_for_user.size() >= 50)
+        if (write_file)
         {
-            int userId = user_pair.first;
-            char *ptr = line_buffer;
-            char *const end_ptr = line_buffer + sizeof(line_buffer);
-
-            auto [p1, ec1] = std::to_chars(ptr, end_ptr, userId);
-            if (ec1 != std::errc())
-                continue;
-            ptr = p1;
+            // Cada avaliação ocupa no máximo 1 + 11 + 1 + 16 bytes.
+            line_buffer.resize(16 + valid_ratings_for_user.size() * 32);
+            char *ptr = line_buffer.data();
+            char *const end_ptr = ptr + line_buffer.size();
 
+            ptr = std::to_chars(ptr, end_ptr, userId).ptr;
             for (const auto &rating : valid_ratings_for_user)
             {
-                if (end_ptr - ptr < 50)
-                    break;
                 *ptr++ = ' ';
-                auto [p2, ec2] = std::to_chars(ptr, end_ptr, rating.movieId);
-                if (ec2 != std::errc())
-                    break;
-                ptr = p2;
+                ptr = std::to_chars(ptr, end_ptr, rating.movieId).ptr;
                 *ptr++ = ':';
-                auto [p3, ec3] = std::to_chars(ptr, end_ptr, rating.rating, std::chars_format::fixed, 1);
-                if (ec3 != std::errc())
-                    break;
-                ptr = p3;
+                ptr = std::to_chars(ptr, end_ptr, rating.rating, std::chars_format::fixed, 1).ptr;
             }
             *ptr++ = '\n';
-            add_to_buffer(line_buffer, ptr - line_buffer);
+            add_to_buffer(line_buffer.data(), ptr - line_buffer.data());
         }
+
+        valid_ratings_for_user.clear();
+    };
+
+    RatingsCsvScanner scanner(chunk->start, chunk->end);
+    char *released = chunk->start;
+    int currentUser = 0;
+    int userId, movieId;
+    float rating;
+
+    while (scanner.next(userId, movieId, rating))
+    {
+        if (userId != currentUser)
+        {
+            flush_user(currentUser);
+            currentUser = userId;
+        }
+        if (static_cast<size_t>(movieId) < valid_movies->size() && (*valid_movies)[movieId])
+        {
+            valid_ratings_for_user.emplace_back(movieId, rating);
+        }
+        release_consumed(released, scanner.position());
     }
+    flush_user(currentUser);
 
-    flush_buffer();
-    fclose(output_file);
+    if (output_file)
+    {
+        flush_buffer();
+        fclose(output_file);
+    }
 }
 
-void concatenate_temp_files(int num_threads)
+void concatenate_temp_files(int num_chunks)
 {
     const char *final_filename = "datasets/input.dat";
     FILE *final_output = fopen(final_filename, "wb");
@@ -196,7 +243,7 @@ void concatenate_temp_files(int num_threads)
 
     std::vector<char> concat_buffer(4 * 1024 * 1024);
 
-    for (int i = 0; i < num_threads; ++i)
+    for (int i = 0; i < num_chunks; ++i)
     {
         std::string temp_filename = "datasets/input.dat.tmp." + std::to_string(i);
         FILE *temp_input = fopen(temp_filename.c_str(), "rb");
@@ -214,7 +261,7 @@ void concatenate_temp_files(int num_threads)
     fclose(final_output);
 }
 
-int process_ratings_file()
+int process_ratings_file(std::vector<RatingBatch> *batches, bool write_input_file)
 {
     std::ios_base::sync_with_stdio(false);
     std::cin.tie(nullptr);
@@ -249,61 +296,74 @@ int process_ratings_file()
     char *end_pos = file_data + sb.st_size;
     safe_advance_to_next_line(current_pos, end_pos);
 
-    const int num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    ThreadPool &pool = ThreadPool::instance();
     const size_t data_size = end_pos - current_pos;
-    const size_t chunk_size = data_size / num_threads;
+    const int num_chunks = static_cast<int>(std::clamp<size_t>(data_size / MIN_CHUNK_BYTES, 1, pool.concurrency() * 4));
+    const size_t chunk_size = data_size / num_chunks;
 
-    std::vector<DataChunk> chunks(num_threads);
-    std::vector<std::thread> threads;
-
-    
-    for (int i = 0; i < num_threads; i++)
-    {
-        chunks[i].start = current_pos + (i * chunk_size);
-        chunks[i].end = (i == num_threads - 1) ? end_pos : current_pos + ((i + 1) * chunk_size);
-        threads.emplace_back(process_chunk, &chunks[i]);
-    }
-    for (auto &t : threads)
+    std::vector<DataChunk> chunks(num_chunks);
+    for (int i = 0; i < num_chunks; i++)
     {
-        t.join();
+        chunks[i].start = (i == 0) ? current_pos : chunks[i - 1].end;
+        chunks[i].end = (i == num_chunks - 1)
+                            ? end_pos
+                            : align_to_user_boundary(std::max(chunks[i].start, current_pos + (i + 1) * chunk_size), current_pos, end_pos);
     }
 
-    std::unordered_map<int, int> movie_count;
-    movie_count.reserve(60000);
-    for (const auto &chunk : chunks)
+    // Passo 1: só a contagem de avaliações por filme.
+    std::vector<std::vector<uint32_t>> movie_counts(num_chunks);
     {
-        for (const auto &movie_pair : chunk.local_movie_count)
+        TaskGroup tasks(pool);
+        for (int i = 0; i < num_chunks; i++)
         {
-            movie_count[movie_pair.first] += movie_pair.second;
+            tasks.run([&chunks, &movie_counts, i]()
+                      { count_movies_chunk(&chunks[i], &movie_counts[i]); });
         }
+        tasks.wait();
     }
 
-    std::unordered_set<int> valid_movies;
-    valid_movies.reserve(20000);
-    for (const auto &[movieId, count] : movie_count)
+    std::vector<uint32_t> movie_count;
+    for (const auto &counts : movie_counts)
     {
-        if (count >= 50)
-        {
-            valid_movies.insert(movieId);
-        }
+        if (movie_count.size() < counts.size())
+            movie_count.resize(counts.size(), 0);
+        for (size_t m = 0; m < counts.size(); m++)
+            movie_count[m] += counts[m];
+    }
+    movie_counts.clear();
+
+    std::vector<uint8_t> valid_movies(movie_count.size(), 0);
+    for (size_t m = 0; m < movie_count.size(); m++)
+    {
+        valid_movies[m] = movie_count[m] >= 50;
     }
     movie_count.clear();
 
-    if (system("mkdir -p datasets 2>/dev/null") != 0)
+    if (write_input_file && system("mkdir -p datasets 2>/dev/null") != 0)
     {
     }
 
-    threads.clear();
-    for (int i = 0; i < num_threads; i++)
+    if (batches)
     {
-        threads.emplace_back(filter_and_write_chunk, &chunks[i], &valid_movies, i);
+        batches->assign(num_chunks, RatingBatch());
     }
-    for (auto &t : threads)
+
+    // Passo 2: percorre cada chunk (alinhado em fronteiras de usuário) filtrando usuário a usuário.
     {
-        t.join();
+        TaskGroup tasks(pool);
+        for (int i = 0; i < num_chunks; i++)
+        {
+            RatingBatch *batch = batches ? &(*batches)[i] : nullptr;
+            tasks.run([&chunks, &valid_movies, i, batch, write_input_file]()
+                      { filter_and_write_chunk(&chunks[i], &valid_movies, i, batch, write_input_file); });
+        }
+        tasks.wait();
     }
 
-    concatenate_temp_files(num_threads);
+    if (write_input_file)
+    {
+        concatenate_temp_files(num_chunks);
+    }
 
     munmap(file_data, sb.st_size);
 
@@ -2,6 +2,7 @@
 #define PREPROCESSAMENTO_HPP
 
 #include "Config.hpp"
+#include "DataStructures.hpp"
 
 struct Rating {
     int movieId;
@@ -20,8 +21,6 @@ struct Rating {
 struct DataChunk {
     char* start;
     char* end;
-    std::unordered_map<int, std::vector<Rating>> local_user_data;
-    std::unordered_map<int, int> local_movie_count;
 };
 
 inline bool is_digit(char c);
@@ -31,13 +30,19 @@ inline void safe_advance_to_next_line(char*& p, char* end);
 
 
 
-void process_chunk(DataChunk* chunk);
+// Passo 1: conta as avaliações válidas por filme (vetor denso indexado por movieId).
+void count_movies_chunk(const DataChunk* chunk, std::vector<uint32_t>* movie_count);
 
-void filter_and_write_chunk(const DataChunk* chunk, const std::unordered_set<int>* valid_movies, int thread_id);
+// Passo 2: percorre as sequências de cada usuário e mantém os que têm ao menos 50 avaliações de
+// filmes válidos; as linhas aceitas vão para batch (se não for nulo) e/ou para o arquivo temporário.
+void filter_and_write_chunk(const DataChunk* chunk, const std::vector<uint8_t>* valid_movies, int chunk_id,
+                            RatingBatch* batch, bool write_file);
 
-void concatenate_temp_files(int num_threads);
+void concatenate_temp_files(int num_chunks);
 
-int process_ratings_file();
+// Com batches != nullptr os dados filtrados são entregues em memória ao DataLoader;
+// o input.dat só é gravado quando write_input_file é verdadeiro.
+int process_ratings_file(std::vector<RatingBatch>* batches = nullptr, bool write_input_file = true);
 
 const char* find_ratings_file();
 